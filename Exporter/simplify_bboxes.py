@@ -0,0 +1,212 @@
+import argparse
+import json
+import math
+import random
+import sys
+
+# Offline simplifier for the collision boxes exported from Blender (bb#_bboxes.json).
+#
+# Two passes, both keep the union of the boxes unchanged:
+#   1. drop every box that is fully contained in another box
+#   2. greedily merge pairs whose union is itself a box, i.e. boxes with the
+#      same extent on two axes that touch or overlap on the third
+# The result is checked by sampling points and comparing whether each one is
+# blocked before and after. Needs only the Python standard library.
+#
+# python Exporter/simplify_bboxes.py server/src/bb#_bboxes.json -o server/src/bb#_bboxes.json
+
+AXES = 3
+
+# verification grid cell size over the XY plane, same as the server default
+CELL_SIZE = 0.25
+
+
+def read_boxes(path):
+    with open(path) as f:
+        data = json.load(f)
+    return [(name, tuple(box["min"]), tuple(box["max"])) for name, box in data.items()]
+
+
+def write_boxes(path, boxes):
+    data = {name: {"min": list(mn), "max": list(mx)} for name, mn, mx in boxes}
+    with open(path, "w") as f:
+        json.dump(data, f, indent=4)
+
+
+def contains(outer, inner, eps):
+    _, omin, omax = outer
+    _, imin, imax = inner
+    return all(omin[i] <= imin[i] + eps and omax[i] >= imax[i] - eps for i in range(AXES))
+
+
+def drop_contained(boxes, eps):
+    # biggest first so a box is only ever tested against boxes that can hold it
+    def volume(box):
+        _, mn, mx = box
+        return math.prod(mx[i] - mn[i] for i in range(AXES))
+
+    kept = []
+    for box in sorted(boxes, key=volume, reverse=True):
+        if not any(contains(other, box, eps) for other in kept):
+            kept.append(box)
+    return kept
+
+
+def merged(a, b, eps):
+    """Returns the union of a and b if it is a box, otherwise None."""
+    name, amin, amax = a
+    _, bmin, bmax = b
+    free_axis = -1
+    for i in range(AXES):
+        if abs(amin[i] - bmin[i]) <= eps and abs(amax[i] - bmax[i]) <= eps:
+            continue
+        if free_axis >= 0:
+            return None
+        free_axis = i
+    if free_axis >= 0 and (amin[free_axis] > bmax[free_axis] + eps or bmin[free_axis] > amax[free_axis] + eps):
+        return None
+    return (name,
+            tuple(min(amin[i], bmin[i]) for i in range(AXES)),
+            tuple(max(amax[i], bmax[i]) for i in range(AXES)))
+
+
+def merge_boxes(boxes, eps):
+    boxes = list(boxes)
+    merges = 0
+    changed = True
+    while changed:
+        changed = False
+        i = 0
+        while i < len(boxes):
+            j = i + 1
+            while j < len(boxes):
+                union = merged(boxes[i], boxes[j], eps)
+                if union is None:
+                    j += 1
+                    continue
+                # the grown box may now merge with boxes already passed over
+                boxes[i] = union
+                del boxes[j]
+                merges += 1
+                changed = True
+                j = i + 1
+            i += 1
+    return boxes, merges
+
+
+class BoxGrid:
+    """Uniform XY grid over a box list, answers 'is this point blocked' queries."""
+
+    def __init__(self, boxes, bounds):
+        self.boxes = boxes
+        (self.min_x, self.min_y, _), (max_x, max_y, _) = bounds
+        self.cells_x = max(1, math.ceil((max_x - self.min_x) / CELL_SIZE))
+        self.cells_y = max(1, math.ceil((max_y - self.min_y) / CELL_SIZE))
+        self.cells = [[] for _ in range(self.cells_x * self.cells_y)]
+        for box in boxes:
+            _, mn, mx = box
+            x0, y0 = self.cell(mn[0], mn[1])
+            x1, y1 = self.cell(mx[0], mx[1])
+            for y in range(y0, y1 + 1):
+                for x in range(x0, x1 + 1):
+                    self.cells[y * self.cells_x + x].append(box)
+
+    def cell(self, x, y):
+        cx = min(max(int((x - self.min_x) // CELL_SIZE), 0), self.cells_x - 1)
+        cy = min(max(int((y - self.min_y) // CELL_SIZE), 0), self.cells_y - 1)
+        return cx, cy
+
+    def blocked(self, p, grow=0.0):
+        # strict test, same as checkCollision on the server, boxes grown by `grow`
+        x, y = self.cell(p[0], p[1])
+        for _, mn, mx in self.cells[y * self.cells_x + x]:
+            if all(mn[i] - grow < p[i] < mx[i] + grow for i in range(AXES)):
+                return True
+        return False
+
+
+def bounds_of(boxes, margin):
+    lo = tuple(min(mn[i] for _, mn, _ in boxes) - margin for i in range(AXES))
+    hi = tuple(max(mx[i] for _, _, mx in boxes) + margin for i in range(AXES))
+    return lo, hi
+
+
+def sample_points(boxes, bounds, count, rng):
+    """Uniform points over the level, plus points just inside and outside every face."""
+    lo, hi = bounds
+    points = [tuple(rng.uniform(lo[i], hi[i]) for i in range(AXES)) for _ in range(count)]
+    for _, mn, mx in boxes:
+        for axis in range(AXES):
+            for face in (mn[axis], mx[axis]):
+                size = max(mx[axis] - mn[axis], 1e-6)
+                for offset in (-1e-3 * size, 1e-3 * size):
+                    p = [rng.uniform(mn[i], mx[i]) for i in range(AXES)]
+                    p[axis] = face + offset
+                    points.append(tuple(p))
+    return points
+
+
+def verify(before, after, samples, seed, eps):
+    """Returns (points checked, points blocked in one set but not the other).
+    Points within eps of an original face may legitimately differ and are skipped."""
+    rng = random.Random(seed)
+    bounds = bounds_of(before, 0.1)
+    grid_before = BoxGrid(before, bounds)
+    grid_after = BoxGrid(after, bounds)
+    checked = 0
+    mismatches = []
+    for p in sample_points(before, bounds, samples, rng):
+        blocked = grid_before.blocked(p)
+        if eps > 0 and grid_before.blocked(p, -eps) != grid_before.blocked(p, eps):
+            continue
+        checked += 1
+        if blocked != grid_after.blocked(p):
+            mismatches.append(p)
+    return checked, mismatches
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Merge and drop redundant collision boxes.")
+    parser.add_argument("input", help="bbox JSON exported from Blender")
+    parser.add_argument("-o", "--output", help="where to write the reduced set (default: report only)")
+    parser.add_argument("--eps", type=float, default=0.0,
+                        help="faces closer than this count as equal; 0 keeps the space exactly identical, "
+                             "otherwise it only changes within eps of a face")
+    parser.add_argument("--samples", type=int, default=200000, help="uniform sample points for verification")
+    parser.add_argument("--seed", type=int, default=125)
+    args = parser.parse_args()
+
+    boxes = read_boxes(args.input)
+    before = len(boxes)
+
+    reduced = drop_contained(boxes, args.eps)
+    contained = before - len(reduced)
+    reduced, merges = merge_boxes(reduced, args.eps)
+    # merging can grow a box around others
+    grown = len(reduced)
+    reduced = drop_contained(reduced, args.eps)
+    contained += grown - len(reduced)
+
+    # keep the exported order for whatever is left
+    order = {name: i for i, (name, _, _) in enumerate(boxes)}
+    reduced.sort(key=lambda box: order[box[0]])
+
+    print(f"boxes:     {before} -> {len(reduced)} ({100.0 * (before - len(reduced)) / max(before, 1):.1f}% fewer)")
+    print(f"contained: {contained} dropped")
+    print(f"merged:    {merges} pairs")
+
+    checked, mismatches = verify(boxes, reduced, args.samples, args.seed, args.eps)
+    print(f"verify:    {checked} points, {len(mismatches)} differ")
+    for p in mismatches[:10]:
+        print(f"    ({p[0]:.6f}, {p[1]:.6f}, {p[2]:.6f})")
+    if mismatches:
+        return 1
+
+    if args.output:
+        write_boxes(args.output, reduced)
+        print(f"wrote {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
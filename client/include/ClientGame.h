@@ -4,10 +4,15 @@
 #include <Windows.h>
 #include "ClientNetwork.h"
 #include "NetworkData.h"
+#include "Snapshot.h"
+#include "PlayerMovement.h"
+#include "InterpolationBuffer.h"
 #include "Renderer.h"
 #include "fmod.hpp"
 #include "fmod_errors.h"
 #include "AudioEngine.h"
+#include <chrono>
+#include <deque>
 #include <string>
 using namespace std;
 
@@ -21,7 +26,7 @@ using namespace std;
 
 class ClientGame {
 public:
-	ClientGame(HINSTANCE hInstance,  int nCmdShow, string IPAddress);
+	ClientGame(HINSTANCE hInstance,  int nCmdShow, string IPAddress, bool udp = false);
 	~ClientGame(void);
 
 	bool isWindowFocused() const;
@@ -46,17 +51,22 @@ public:
 
 	void sendDebugPacket(const char*);
 	// void sendGameStatePacket(float[4]);
-	void sendMovePacket(float[3], float, float, bool);
+	void sendMovePacket(const MovePayload& mv);
 	void sendCameraPacket(float, float);
 	void sendAttackPacket(float origin[3], float yaw, float pitch);
 	void sendDodgePacket();
 	void sendBearPacket();
 	void sendPhantomPacket();
 	void sendNocturnalPacket();
+	void sendSnapshotAck(uint32_t sequence);
 	void sendReadyStatusPacket(uint8_t selection);
 	void update();
+	void applyGameState();
+	void predict(const MovePayload& input);
+	void reconcile(const GameState& server, uint32_t inputSequence);
+	void applyInterpolation();
 
-	GameState* gameState;
+	GameState* gameState;   // latestState
 	AppState* appState;
 	Renderer renderer;
 
@@ -85,6 +95,42 @@ private:
 	int id = -1; // -1 is pre-initialization. 0 should be hunter. 4 should be spectator
 	ClientNetwork* network;
 	char network_data[MAX_PACKET_SIZE]; //todo this should change once we define the packet sizes
+	// frames between [NET] receive stats
+	static constexpr uint64_t STATS_FRAMES = 10000;
+
+	// last state from the server; input handling may edit it, so snapshot
+	// baselines are kept apart in `snapshots`
+	GameState latestState{};
+	SnapshotHistory snapshots;
+	uint32_t snapshotToAck = 0;   // newest snapshot applied this frame
+
+	// Client-side prediction: the local player moves on its own input right
+	// away, with one MOVE a server tick, and each state from the server is
+	// replayed forward through the inputs it did not include yet
+	static constexpr std::chrono::nanoseconds INPUT_TICK{ 1'000'000'000 / PlayerMovement::TICKS_PER_SEC };
+	// a longer stall skips ticks instead of sending a burst of input
+	static constexpr int MAX_INPUT_TICKS_A_FRAME = 4;
+	static constexpr size_t MAX_UNACKED = PlayerMovement::TICKS_PER_SEC * 2;
+	// a replay ending further than this from the prediction counts as a
+	// correction, well above the snapshots' position quantization
+	static constexpr float CORRECTION_EPSILON = 1e-3f;
+	PlayerMovement movement;
+	std::deque<MovePayload> unacked;   // sent and predicted, oldest first
+	uint32_t inputSequence = 0;        // of the last MOVE sent
+	std::chrono::steady_clock::time_point nextInputTick;
+	bool jumpQueued = false;           // pressed since the last input tick
+	float extraJump = 0.0f;            // jump powerups, as the server adds them
+	struct PredictionStats {
+		uint64_t states = 0;           // server states predicted on
+		uint64_t corrections = 0;
+		uint64_t replayed = 0;         // inputs replayed
+		float maxError = 0.0f;
+	} prediction;
+	bool predictingLocal() const;
+
+	// every player but the predicted one is drawn a few ticks in the past,
+	// between the states the server sent
+	InterpolationBuffer interpolation;
 
 	//camera constants
 	float yaw = 0.0;
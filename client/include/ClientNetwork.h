@@ -5,7 +5,10 @@
 #include <stdio.h>
 #include "NetworkServices.h"
 #include "NetworkData.h"
+#include "UdpTransport.h"
+#include "PacketRing.h"
 #include <string>
+#include <vector>
 
 #define DEFAULT_BUFLEN 512
 #define DEFAULT_PORT "2333"
@@ -21,8 +24,35 @@ public:
 	SOCKET ConnectSocket;
 
 	ClientNetwork(void);
-	ClientNetwork(std::string IPAddress);
+	// over UDP when `udp` is set, see UdpTransport.h
+	ClientNetwork(std::string IPAddress, bool udp = false);
 	~ClientNetwork(void);
 
+	// sends every packet in `packets`, TCP or UDP alike
+	int send(char* packets, int totalSize);
+	// Reads everything the server sent since the last call, once a frame
+	void receive();
+	// the next whole packet receive() read, 0 when there is none left
 	int receivePackets(char*);
+
+	struct ReceiveStats {
+		uint64_t frames = 0;      // receive() calls
+		uint64_t syscalls = 0;    // polls and reads
+		uint64_t packets = 0;
+	};
+	const ReceiveStats& receiveStats() const { return stats; }
+	void resetReceiveStats() { stats = {}; }
+
+private:
+	void connectUdp(std::string IPAddress);
+
+	PacketRing inbox;
+	ReceiveStats stats;
+	bool closed = false;      // the server closed the TCP connection
+
+	bool udp = false;
+	UdpSocket udpSocket;
+	sockaddr_in serverAddr{};
+	UdpConnection connection;
+	std::vector<char> udpInbox;
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include "NetworkData.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// The players of every state the server sent, by server tick, so they can be
+// drawn a little in the past, between the two states around the render time,
+// instead of jumping each time a packet happens to arrive. The frame rate no
+// longer has anything to do with when packets come in.
+//
+// Arrival times give an estimate of the server tick on the client's clock,
+// following the earliest arrivals: a state can only be delayed on the way,
+// so a burst of late ones says little about the server. Players are drawn
+// `delay` ticks behind it: two ticks, plus three times the measured arrival
+// jitter so the state after the render time has nearly always arrived. The
+// delay follows the jitter slowly, so players never visibly speed up or slow
+// down when it changes.
+//
+// When the next state is late anyway, players carry on for a few ticks the
+// way they were going: at the speed between their last two states, along
+// their jump under GRAVITY if they were in the air, but never below their
+// last state, since what they would land on is not known. Once a real state
+// arrives, the gap between where they were drawn and where they were is
+// closed over a short blend instead of in one frame.
+class InterpolationBuffer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t CAPACITY = 32;             // ticks kept for each player
+	static constexpr double BASE_DELAY_TICKS = 2.0;
+	static constexpr double JITTER_MARGIN = 3.0;       // ticks of delay for each tick of jitter
+	static constexpr double MAX_DELAY_TICKS = 16.0;
+	// arrivals further than this off the estimate mean the clock is wrong, not jittery
+	static constexpr double RESYNC_TICKS = 32.0;
+	// two states further apart than this for each tick between them are a
+	// teleport (spawn, new round), not movement, some fifty times a run
+	static constexpr float TELEPORT_SPEED = 1.0f;
+	// ticks players go on past the newest state before they stop and wait
+	static constexpr double MAX_EXTRAPOLATION_TICKS = 8.0;
+	// time constant of the blend back after a guess, in seconds
+	static constexpr double BLEND_SECONDS = 0.1;
+
+	struct Pose {
+		float x, y, z;
+		float yaw, pitch;
+	};
+
+	struct Stats {
+		uint64_t samples = 0;        // players drawn
+		uint64_t extrapolated = 0;   // drawn past the newest state, the next one was late
+		uint64_t held = 0;           // late for longer than extrapolation goes
+	};
+
+	// records the players of a state from the server as it arrives
+	void push(const GameState& state, Clock::time_point arrival);
+	// moves the render time to `now`, once a frame before sample()
+	void advance(Clock::time_point now);
+	// where `player` is drawn this frame, false before any state arrived
+	bool sample(int player, Pose& pose);
+
+	// the server tick players are drawn at this frame, 0 before any state arrived
+	double renderedTick() const { return renderTick; }
+	double delayTicks() const { return delay; }
+	double jitterTicks() const { return jitter; }
+	const Stats& stats() const { return counters; }
+	void resetStats() { counters = {}; }
+
+private:
+	// gains of the moving averages, a fraction of the way each arrival
+	static constexpr double OFFSET_GAIN_EARLY = 0.2;
+	static constexpr double OFFSET_GAIN_LATE = 0.01;
+	static constexpr double JITTER_GAIN = 0.05;
+	static constexpr double DELAY_GAIN = 0.02;
+
+	struct Sample {
+		uint64_t tick = UINT64_MAX;   // none yet
+		Pose pose;
+		float zVelocity;
+		bool airborne;                // follows GRAVITY until the next state
+		bool flying;                  // phantom hunter, moves up and down without gravity
+	};
+	struct Track {
+		std::array<Sample, CAPACITY> samples;
+		uint64_t newest = 0;
+		bool any = false;
+		// last frame, to blend from when a state replaces a guess
+		Pose drawn;
+		double drawnTick = 0.0;
+		uint64_t drawnNewest = 0;
+		bool guessed = false;
+		float blend[3] = {};          // added to the position, shrinking to nothing
+	};
+	enum class Source {
+		INTERPOLATED,
+		EXTRAPOLATED,
+		HELD,
+	};
+
+	void clear();
+	// where the states of `track` put a player at `tick`
+	Source poseAt(const Track& track, double tick, Pose& pose) const;
+	const Sample* previous(const Track& track, uint64_t tick) const;
+	double seconds(Clock::time_point t) const;
+
+	std::array<Track, 4> tracks;
+	bool synced = false;
+	Clock::time_point epoch;   // of the time estimates, to keep them small
+	double offset = 0.0;       // server tick minus client time in ticks, for the earliest arrivals
+	double jitter = 0.0;       // mean distance of an arrival from the estimate, in ticks
+	double delay = BASE_DELAY_TICKS;
+	double renderTick = 0.0;   // only moves forward, but for a resync
+	double frameSeconds = 0.0;   // since the last advance()
+	Clock::time_point lastAdvance;
+	Stats counters;
+};
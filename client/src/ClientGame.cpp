@@ -1,5 +1,6 @@
 ﻿#include "ClientGame.h"
 #include <algorithm>
+#include <cmath>
 #include <string>
 #include <iostream>
 using namespace std;
@@ -7,15 +8,20 @@ const wchar_t CLASS_NAME[] = L"Window Class";
 const wchar_t GAME_NAME[] = L"Tiny Terrors";
 
 
-ClientGame::ClientGame(HINSTANCE hInstance, int nCmdShow, string IPAddress) {
-	network = new ClientNetwork(IPAddress);
+ClientGame::ClientGame(HINSTANCE hInstance, int nCmdShow, string IPAddress, bool udp) {
+	network = new ClientNetwork(IPAddress, udp);
 
 	InitPayload init{};  // empty payload for now
 	char packet_data[HDR_SIZE + sizeof(InitPayload)];
 
 	NetworkServices::buildPacket<InitPayload>(PacketType::INIT_CONNECTION, init, packet_data);
 
-	NetworkServices::sendMessage(network->ConnectSocket, packet_data, HDR_SIZE + sizeof(InitPayload));
+	network->send(packet_data, HDR_SIZE + sizeof(InitPayload));
+
+	// the level the server collides with, so the local player can be predicted
+	if (!movement.loadCollision(L"bb#_bboxes.bin", L"bb#_bboxes.json")) {
+		printf("[PREDICT] no level collision, the local player waits for the server\n");
+	}
 
 	WNDCLASSEX windowClass = { 
 		.cbSize = sizeof(WNDCLASSEX),
@@ -67,6 +73,7 @@ ClientGame::ClientGame(HINSTANCE hInstance, int nCmdShow, string IPAddress) {
 
 	appState = new AppState();
 	appState->gamePhase = GamePhase::START_MENU;
+	gameState = &latestState;
 	appState->gameState = gameState;
 
 	audioEngine->Init();
@@ -120,20 +127,13 @@ void ClientGame::sendDebugPacket(const char* message) {
 
 	char packet_data[HDR_SIZE + sizeof(DebugPayload)];
 	NetworkServices::buildPacket<DebugPayload>(PacketType::DEBUG, dbg, packet_data);
-	NetworkServices::sendMessage(network->ConnectSocket, packet_data, HDR_SIZE + sizeof(DebugPayload));
+	network->send(packet_data, HDR_SIZE + sizeof(DebugPayload));
 }
 
-void ClientGame::sendMovePacket(float direction[3], float yaw, float pitch, bool jump) {
-	MovePayload mv{};
-	for (int i = 0; i < 3; i++)
-		mv.direction[i] = direction[i];
-	mv.yaw = yaw;
-	mv.pitch = pitch;
-	mv.jump = jump;
-
+void ClientGame::sendMovePacket(const MovePayload& mv) {
 	char packet_data [HDR_SIZE + sizeof(MovePayload)];
 	NetworkServices::buildPacket<MovePayload>(PacketType::MOVE, mv, packet_data);
-	NetworkServices::sendMessage(network->ConnectSocket, packet_data, HDR_SIZE + sizeof(MovePayload));
+	network->send(packet_data, HDR_SIZE + sizeof(MovePayload));
 }
 
 void ClientGame::sendCameraPacket(float yaw, float pitch) {
@@ -143,7 +143,7 @@ void ClientGame::sendCameraPacket(float yaw, float pitch) {
 
 	char buf[HDR_SIZE + sizeof(cam)];
 	NetworkServices::buildPacket(PacketType::CAMERA, cam, buf);
-	NetworkServices::sendMessage(network->ConnectSocket, buf, sizeof buf);
+	network->send(buf, sizeof buf);
 }
 
 void ClientGame::sendReadyStatusPacket(uint8_t selection = 0) {
@@ -156,7 +156,7 @@ void ClientGame::sendReadyStatusPacket(uint8_t selection = 0) {
 
 	char buf[HDR_SIZE + sizeof(status)];
 	NetworkServices::buildPacket(PacketType::PLAYER_READY, status, buf);
-	NetworkServices::sendMessage(network->ConnectSocket, buf, sizeof buf);
+	network->send(buf, sizeof buf);
 }
 
 void ClientGame::sendAttackPacket(float origin[3], float yaw, float pitch) {
@@ -170,7 +170,7 @@ void ClientGame::sendAttackPacket(float origin[3], float yaw, float pitch) {
 
 	char packet_data[HDR_SIZE + sizeof(AttackPayload)];
 	NetworkServices::buildPacket(PacketType::ATTACK, atk, packet_data);
-	NetworkServices::sendMessage(network->ConnectSocket,
+	network->send(
 		packet_data,
 		sizeof packet_data);
 }
@@ -180,7 +180,7 @@ void ClientGame::sendDodgePacket()
 	DodgePayload dp{ yaw, pitch };
 	char buf[HDR_SIZE + sizeof dp];
 	NetworkServices::buildPacket(PacketType::DODGE, dp, buf);
-	NetworkServices::sendMessage(network->ConnectSocket, buf, sizeof buf);
+	network->send(buf, sizeof buf);
 }
 
 void ClientGame::sendBearPacket()
@@ -188,7 +188,7 @@ void ClientGame::sendBearPacket()
 	BearPayload bp{ };
 	char buf[HDR_SIZE + sizeof bp];
 	NetworkServices::buildPacket(PacketType::BEAR, bp, buf);
-	NetworkServices::sendMessage(network->ConnectSocket, buf, sizeof buf);
+	network->send(buf, sizeof buf);
 }
 
 void ClientGame::sendPhantomPacket()
@@ -196,7 +196,7 @@ void ClientGame::sendPhantomPacket()
 	PhantomPayload pp{ };
 	char buf[HDR_SIZE + sizeof pp];
 	NetworkServices::buildPacket(PacketType::PHANTOM, pp, buf);
-	NetworkServices::sendMessage(network->ConnectSocket, buf, sizeof buf);
+	network->send(buf, sizeof buf);
 }
 
 void ClientGame::sendNocturnalPacket()
@@ -204,12 +204,22 @@ void ClientGame::sendNocturnalPacket()
 	NocturnalPayload pp{ };
 	char buf[HDR_SIZE + sizeof pp];
 	NetworkServices::buildPacket(PacketType::NOCTURNAL, pp, buf);
-	NetworkServices::sendMessage(network->ConnectSocket, buf, sizeof buf);
+	network->send(buf, sizeof buf);
+}
+
+void ClientGame::sendSnapshotAck(uint32_t sequence)
+{
+	SnapshotAckPayload ack{ sequence };
+	char buf[HDR_SIZE + sizeof ack];
+	NetworkServices::buildPacket(PacketType::SNAPSHOT_ACK, ack, buf);
+	network->send(buf, sizeof buf);
 }
 
 void ClientGame::update() {
 
 	// check for server updates and process them accordingly
+	network->receive();
+	auto arrival = chrono::steady_clock::now();
 	int len = network->receivePackets(network_data);
 	while (len > 0) {
 		// here, network_data should contain the game state packet
@@ -218,41 +228,31 @@ void ClientGame::update() {
 		case PacketType::GAME_STATE: 
 		{
 			// printf("received update for tick %llu \n", game_state->tick);
-			gameState = (GameState*)(network_data + HDR_SIZE);
-			//char msgbuf[1000];
-			// printf(msgbuf, "Packet received y=%f \n", state->position[1]);
-
-			for (int i = 0; i < 4; i++) {
-				renderer.players[i].pos.x = gameState->players[i].x;
-				renderer.players[i].pos.y = gameState->players[i].y;
-				renderer.players[i].pos.z = gameState->players[i].z;
-				renderer.players[i].isHunter = gameState->players[i].isHunter;  // NEW
-
-				// update the rotation from other players only (only if not spectator, otherwise gotta update everything) (only for game phase)
-				if (id != 4 && i == renderer.currPlayer.playerId && appState->gamePhase == GamePhase::GAME_PHASE) continue;
-				renderer.players[i].lookDir.pitch = gameState->players[i].pitch;
-				renderer.players[i].lookDir.yaw = gameState->players[i].yaw;
+			GameState state;
+			uint32_t inputSequence = 0;
+			memcpy(&state, network_data + HDR_SIZE, sizeof state);
+			if (hdr->len >= HDR_SIZE + sizeof(GameState) + sizeof(uint32_t)) {
+				memcpy(&inputSequence, network_data + HDR_SIZE + sizeof(GameState), sizeof inputSequence);
 			}
-
-			// cache own dead flag for input handling
-			localDead = gameState->players[renderer.currPlayer.playerId].isDead;
-
-			// update timer
-			renderer.updateTimer(gameState->timerFrac);
-
-			//playAudio();
-
-			// update client side powerups
-			if (gameState->tick >= instinctExpireTick) {
-				renderer.instinct = false;
-			}
-			if (gameState->tick >= nocturnalExpireTick) {
-				renderer.nocturnal = false;
-			}
-			for (int i = 0; i < 4; ++i) {
-				renderer.players[i].isDead = gameState->players[i].isDead;
-				renderer.players[i].isBear = gameState->players[i].isBear;
+			interpolation.push(state, arrival);
+			reconcile(state, inputSequence);
+			applyGameState();
+			break;
+		}
+		case PacketType::SNAPSHOT:
+		{
+			GameState snapshot;
+			uint32_t sequence, inputSequence;
+			if (!snapshots.decode((uint8_t*)network_data + HDR_SIZE, hdr->len - HDR_SIZE, snapshot, sequence, inputSequence)) {
+				// not acked, so the server falls back to a keyframe
+				printf("[SNAPSHOT] dropped a snapshot without its baseline\n");
+				break;
 			}
+			snapshots.push(sequence, snapshot);
+			snapshotToAck = sequence;
+			interpolation.push(snapshot, arrival);
+			reconcile(snapshot, inputSequence);
+			applyGameState();
 			break;
 		}
 		case PacketType::DEBUG: 
@@ -329,6 +329,8 @@ void ClientGame::update() {
 
 			appState->gamePhase = statusPayload->phase;
 			renderer.gamePhase = statusPayload->phase;
+			// players are put back at their spawns, no input carries over
+			unacked.clear();
 			renderer.winner = statusPayload->winner;
 
 			if (statusPayload->phase == GamePhase::GAME_PHASE) {
@@ -379,6 +381,7 @@ void ClientGame::update() {
 			PlayerPowerupPayload* pwPayload = (PlayerPowerupPayload*)(network_data + HDR_SIZE);
 			
 			bunnyhop = false;
+			extraJump = 0.0f;
 
 			for (int i = 0; i < 20; i++)
 			{
@@ -387,6 +390,10 @@ void ClientGame::update() {
 					pwPayload->powerupInfo[id][i] == (uint8_t)Powerup::R_BUNNY_HOP) {
 					bunnyhop = true;
 				}
+				if (pwPayload->powerupInfo[id][i] == (uint8_t)Powerup::H_INCREASE_JUMP ||
+					pwPayload->powerupInfo[id][i] == (uint8_t)Powerup::R_INCREASE_JUMP) {
+					extraJump += JUMP_POWERUP;
+				}
 			}
 			renderer.updatePlayerPowerups(&pwPayload->powerupInfo[0][0]);
 			break;
@@ -431,6 +438,34 @@ void ClientGame::update() {
 		}
 		len = network->receivePackets(network_data);
 	}
+	applyInterpolation();
+
+	const ClientNetwork::ReceiveStats& net = network->receiveStats();
+	if (net.frames >= STATS_FRAMES) {
+		printf("[NET] %.2f receive syscalls a frame for %.2f packets\n",
+			(double)net.syscalls / net.frames, (double)net.packets / net.frames);
+		network->resetReceiveStats();
+		if (prediction.states) {
+			printf("[PREDICT] %llu states, %llu corrected (max %.4f), %.1f inputs replayed on each\n",
+				(unsigned long long)prediction.states, (unsigned long long)prediction.corrections,
+				prediction.maxError, (double)prediction.replayed / prediction.states);
+			prediction = {};
+		}
+		const InterpolationBuffer::Stats& interp = interpolation.stats();
+		if (interp.samples) {
+			printf("[INTERP] drawn %.1f ms behind the server (jitter %.1f ms), late states: %.2f%% of players extrapolated, %.2f%% held\n",
+				interpolation.delayTicks() * 1000.0 / PlayerMovement::TICKS_PER_SEC,
+				interpolation.jitterTicks() * 1000.0 / PlayerMovement::TICKS_PER_SEC,
+				100.0 * interp.extrapolated / interp.samples, 100.0 * interp.held / interp.samples);
+			interpolation.resetStats();
+		}
+	}
+
+	// one ack a frame for the newest snapshot is all the server needs
+	if (snapshotToAck) {
+		sendSnapshotAck(snapshotToAck);
+		snapshotToAck = 0;
+	}
 
 	// ---------------------------------------------------------------	
 	// Client Input Handling 
@@ -453,6 +488,114 @@ void ClientGame::update() {
 
 }
 
+// Takes `server` as the latest state, with the local player moved on by the
+// inputs sent after `inputSequence`, the last one the server included
+void ClientGame::reconcile(const GameState& server, uint32_t inputSequence) {
+	while (!unacked.empty() && (int32_t)(unacked.front().sequence - inputSequence) <= 0) {
+		unacked.pop_front();
+	}
+
+	if (!predictingLocal()) {
+		latestState = server;
+		return;
+	}
+
+	PlayerState predicted = latestState.players[id];
+	latestState = server;
+	// the server applies one input a tick, the first one left on the tick after this state
+	uint64_t tick = server.tick;
+	for (const MovePayload& input : unacked) {
+		PlayerMovement::Modifiers modifiers = PlayerMovement::modifiersAt(latestState.players[id], ++tick, extraJump);
+		movement.step(latestState.players, 4, id, &input, modifiers);
+	}
+
+	const PlayerState& now = latestState.players[id];
+	float dx = now.x - predicted.x, dy = now.y - predicted.y, dz = now.z - predicted.z;
+	float error = sqrtf(dx * dx + dy * dy + dz * dz);
+	prediction.states++;
+	prediction.replayed += unacked.size();
+	if (error > CORRECTION_EPSILON) {
+		prediction.corrections++;
+		prediction.maxError = max(prediction.maxError, error);
+	}
+}
+
+bool ClientGame::predictingLocal() const {
+	return movement.loaded() && id >= 0 && id < 4 && appState->gamePhase == GamePhase::GAME_PHASE;
+}
+
+// Runs one input on the local player ahead of the server
+void ClientGame::predict(const MovePayload& input) {
+	if (!movement.loaded()) return;
+	unacked.push_back(input);
+	// the server stopped answering, only the newest inputs can still matter
+	if (unacked.size() > MAX_UNACKED) unacked.pop_front();
+
+	// the tick the server will apply it on, counting on from its last state
+	uint64_t tick = latestState.tick + unacked.size();
+	PlayerMovement::Modifiers modifiers = PlayerMovement::modifiersAt(latestState.players[id], tick, extraJump);
+	movement.step(latestState.players, 4, id, &input, modifiers);
+	renderer.players[id].pos.x = latestState.players[id].x;
+	renderer.players[id].pos.y = latestState.players[id].y;
+	renderer.players[id].pos.z = latestState.players[id].z;
+}
+
+// Places the players for this frame: the local player where the prediction
+// has it, everyone else from the interpolation buffer
+void ClientGame::applyInterpolation() {
+	interpolation.advance(chrono::steady_clock::now());
+	bool predicting = predictingLocal();
+	for (int i = 0; i < 4; i++) {
+		InterpolationBuffer::Pose pose;
+		if (predicting && i == id) {
+			const PlayerState& local = latestState.players[i];
+			pose = { local.x, local.y, local.z, local.yaw, local.pitch };
+		}
+		else if (!interpolation.sample(i, pose)) {
+			continue;
+		}
+		renderer.players[i].pos.x = pose.x;
+		renderer.players[i].pos.y = pose.y;
+		renderer.players[i].pos.z = pose.z;
+
+		// update the rotation from other players only (only if not spectator, otherwise gotta update everything) (only for game phase)
+		if (id != 4 && i == renderer.currPlayer.playerId && appState->gamePhase == GamePhase::GAME_PHASE) continue;
+		renderer.players[i].lookDir.pitch = pose.pitch;
+		renderer.players[i].lookDir.yaw = pose.yaw;
+	}
+}
+
+// Copies latestState into the renderer, all but the positions which
+// applyInterpolation() places every frame
+void ClientGame::applyGameState() {
+	//char msgbuf[1000];
+	// printf(msgbuf, "Packet received y=%f \n", state->position[1]);
+
+	for (int i = 0; i < 4; i++) {
+		renderer.players[i].isHunter = gameState->players[i].isHunter;  // NEW
+	}
+
+	// cache own dead flag for input handling
+	localDead = gameState->players[renderer.currPlayer.playerId].isDead;
+
+	// update timer
+	renderer.updateTimer(gameState->timerFrac);
+
+	//playAudio();
+
+	// update client side powerups
+	if (gameState->tick >= instinctExpireTick) {
+		renderer.instinct = false;
+	}
+	if (gameState->tick >= nocturnalExpireTick) {
+		renderer.nocturnal = false;
+	}
+	for (int i = 0; i < 4; ++i) {
+		renderer.players[i].isDead = gameState->players[i].isDead;
+		renderer.players[i].isBear = gameState->players[i].isBear;
+	}
+}
+
 ClientGame::~ClientGame() {
 	delete network;
 	delete audioEngine;
@@ -593,7 +736,6 @@ void ClientGame::processSpectatorKeyboardInput()
 bool ClientGame::processMovementInput()
 {
 	float direction[3] = { 0, 0, 0 };
-	bool jump = false;
 	if (GetAsyncKeyState('W') & 0x8000) direction[0] += 1;
 	if (GetAsyncKeyState('S') & 0x8000) direction[0] -= 1;
 	if (GetAsyncKeyState('A') & 0x8000) direction[1] -= 1;
@@ -612,15 +754,31 @@ bool ClientGame::processMovementInput()
 		bool jumpNowDown = (GetAsyncKeyState(' ') & 0x8000) != 0;
 
 	if (jumpNowDown && (!jumpWasDown || bunnyhop)) {     // rising edge
-		jump = true;
+		jumpQueued = true;
 	}
 
 	jumpWasDown = jumpNowDown;
 	}
 
-	if (!direction[0] && !direction[1] && !direction[2] && !jump) return false;
-	sendMovePacket(direction, yaw, pitch, jump);
-	return true;
+	// One input for each server tick since the last frame, idle ones too: the
+	// server only acks what it received, and a tick with no input to replay
+	// would be a tick the prediction skips
+	auto now = chrono::steady_clock::now();
+	if (now - nextInputTick > INPUT_TICK * MAX_INPUT_TICKS_A_FRAME) {
+		nextInputTick = now;
+	}
+	// the tick everyone else is drawn at, so the server checks a swing against what was on screen
+	uint32_t viewTick = (uint32_t)llround(interpolation.renderedTick());
+	bool moved = false;
+	while (nextInputTick <= now) {
+		nextInputTick += INPUT_TICK;
+		MovePayload mv{ { direction[0], direction[1], direction[2] }, yaw, pitch, jumpQueued, ++inputSequence, viewTick };
+		jumpQueued = false;
+		sendMovePacket(mv);
+		predict(mv);
+		moved = moved || mv.jump || direction[0] || direction[1] || direction[2];
+	}
+	return moved;
 }
 
 // 5) Hunter’s left‑click attack, only for client‑0
@@ -19,7 +19,8 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
 		}
 		// convert wstring to char*
 		// User clicked OK; do something with input
-		ClientGame client(hInstance, nCmdShow, input);
+		// --udp on the command line plays over UDP instead of TCP
+		ClientGame client(hInstance, nCmdShow, input, wcsstr(pCmdLine, L"--udp") != nullptr);
 		// set up window
 		MSG msg = {};
 		// application loop
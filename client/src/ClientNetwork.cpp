@@ -1,11 +1,16 @@
 #include "ClientNetwork.h"
 #include <string>
 
-ClientNetwork::ClientNetwork(std::string IPAddress) {
+ClientNetwork::ClientNetwork(std::string IPAddress, bool udp) : udp(udp) {
 	WSADATA wsaData;
 
 	ConnectSocket = INVALID_SOCKET;
 
+	if (udp) {
+		connectUdp(IPAddress);
+		return;
+	}
+
 	struct addrinfo *result = NULL, 
 					*ptr = NULL,
 					hints;
@@ -73,28 +78,113 @@ ClientNetwork::ClientNetwork(std::string IPAddress) {
 	setsockopt(ConnectSocket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
 }
 
-int ClientNetwork::receivePackets(char* recvbuf) {
-	/*
-	iResult = NetworkServices::recvMessage(ConnectSocket, recvbuf, MAX_PACKET_SIZE);
-	if (iResult == 0) {
-		printf("Connection closed\n");
-		closesocket(ConnectSocket);
+void ClientNetwork::connectUdp(std::string IPAddress) {
+	WSADATA wsaData;
+	struct addrinfo *result = NULL, hints;
+
+	iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
+	if (iResult != 0) {
+		printf("WSAStartup failed with error: %d\n", iResult);
+		exit(1);
+	}
+
+	ZeroMemory(&hints, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_protocol = IPPROTO_UDP;
+
+	iResult = getaddrinfo(IPAddress.c_str(), DEFAULT_PORT, &hints, &result);
+	if (iResult != 0) {
+		printf("getaddrinfo failed with error: %d\n", iResult);
 		WSACleanup();
 		exit(1);
 	}
+	memcpy(&serverAddr, result->ai_addr, sizeof(serverAddr));
+	freeaddrinfo(result);
 
-	return iResult;
-	*/
-	if (!NetworkServices::checkMessage(ConnectSocket)) return 0;
+	// there is no handshake, the server takes us in on our first datagram
+	if (!udpSocket.open(0)) {
+		WSACleanup();
+		exit(1);
+	}
+}
+
+int ClientNetwork::send(char* packets, int totalSize) {
+	if (!udp) {
+		return NetworkServices::sendMessage(ConnectSocket, packets, totalSize);
+	}
+
+	connection.send(packets, totalSize, udpNowMs());
+	for (const auto& datagram : connection.outgoing) {
+		udpSocket.sendTo(serverAddr, datagram.data(), datagram.size());
+	}
+	connection.outgoing.clear();
+	return totalSize;
+}
+
+void ClientNetwork::receive() {
+	stats.frames++;
+	if (udp) {
+		uint64_t now = udpNowMs();
+		sockaddr_in from;
+		std::vector<uint8_t> datagram;
+		stats.syscalls++;
+		while (udpSocket.receive(from, datagram)) {
+			stats.syscalls++;
+			connection.receive(datagram.data(), datagram.size(), now, udpInbox);
+		}
+		connection.update(now);
+		for (const auto& out : connection.outgoing) {
+			udpSocket.sendTo(serverAddr, out.data(), out.size());
+		}
+		connection.outgoing.clear();
+		udpSocket.flush(now);
+		return;
+	}
 
-	int r = NetworkServices::recvAll(ConnectSocket, recvbuf, HDR_SIZE);
-	if (r != HDR_SIZE) return r; // error/socket closed
+	// a recv for each free span, of which there are two when the ring wraps;
+	// a short read means the socket is empty. The socket blocks, so each recv
+	// is polled for first: a read that exactly filled the first span may have
+	// left nothing for the second.
+	if (closed) return;
+	for (int spans = 0; spans < 2; spans++) {
+		size_t space;
+		char* span = inbox.writeSpan(space);
+		if (space == 0) return;
+		stats.syscalls++;
+		if (!NetworkServices::checkMessage(ConnectSocket)) return;
+		int r = NetworkServices::recvMessage(ConnectSocket, span, (int)space);
+		stats.syscalls++;
+		if (r <= 0) {
+			// a closed socket polls readable from now on, read it no more
+			printf("Connection closed\n");
+			closed = true;
+			return;
+		}
+		inbox.commit(r);
+		if ((size_t)r < space) return;
+	}
+}
 
-	PacketHeader* hdr = (PacketHeader*)recvbuf;
+int ClientNetwork::receivePackets(char* recvbuf) {
+	if (udp) {
+		if (udpInbox.empty()) return 0;
+		PacketHeader* hdr = (PacketHeader*)udpInbox.data();
+		int length = (int)hdr->len;
+		memcpy(recvbuf, udpInbox.data(), length);
+		udpInbox.erase(udpInbox.begin(), udpInbox.begin() + length);
+		stats.packets++;
+		return length;
+	}
 
-	r = NetworkServices::recvAll(ConnectSocket, recvbuf + HDR_SIZE, hdr->len - HDR_SIZE);
-	if (r <= 0) return r;
-	return hdr->len;
+	PacketRing::View packet;
+	if (!inbox.next(packet)) {
+		if (inbox.corrupt()) printf("bad packet from the server, the stream cannot be read any further\n");
+		return 0;
+	}
+	memcpy(recvbuf, packet.data, packet.length);
+	stats.packets++;
+	return (int)packet.length;
 }
 
 ClientNetwork::~ClientNetwork() {
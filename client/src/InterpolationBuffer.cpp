@@ -0,0 +1,198 @@
+#include "InterpolationBuffer.h"
+#include "PlayerMovement.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static constexpr double TICKS_PER_SEC = PlayerMovement::TICKS_PER_SEC;
+static constexpr float PI = 3.14159265f;
+
+double InterpolationBuffer::seconds(Clock::time_point t) const {
+	return std::chrono::duration<double>(t - epoch).count();
+}
+
+void InterpolationBuffer::clear() {
+	for (Track& track : tracks) {
+		track = Track{};
+	}
+}
+
+// -----------------------------------------------------------------------------
+// ARRIVAL
+// -----------------------------------------------------------------------------
+
+void InterpolationBuffer::push(const GameState& state, Clock::time_point arrival) {
+	if (!synced) {
+		epoch = arrival;
+	}
+
+	// how far the server is ahead of our clock, by this arrival
+	double arrivalOffset = (double)state.tick - seconds(arrival) * TICKS_PER_SEC;
+	double error = arrivalOffset - offset;
+	if (!synced || std::abs(error) > RESYNC_TICKS) {
+		// the first state, a new server or one that stalled: what is kept is
+		// on another timeline, start over from this arrival
+		if (synced) {
+			printf("[INTERP] server tick %.1f off the estimate, resyncing\n", error);
+		}
+		clear();
+		synced = true;
+		offset = arrivalOffset;
+		jitter = 0.0;
+		renderTick = 0.0;
+	}
+	else {
+		offset += (error > 0 ? OFFSET_GAIN_EARLY : OFFSET_GAIN_LATE) * error;
+		jitter += JITTER_GAIN * (std::abs(error) - jitter);
+	}
+	double target = std::clamp(BASE_DELAY_TICKS + JITTER_MARGIN * jitter, BASE_DELAY_TICKS, MAX_DELAY_TICKS);
+	delay += DELAY_GAIN * (target - delay);
+
+	for (int i = 0; i < 4; i++) {
+		Track& track = tracks[i];
+		// a reordered state is still worth keeping while it is in the window
+		if (track.any && state.tick + CAPACITY <= track.newest) continue;
+
+		const PlayerState& player = state.players[i];
+		Sample& slot = track.samples[state.tick % CAPACITY];
+		slot.tick = state.tick;
+		slot.pose = { player.x, player.y, player.z, player.yaw, player.pitch };
+		slot.zVelocity = player.zVelocity;
+		// isGrounded stays set once landed, standing still is a zero zVelocity too
+		slot.airborne = !player.isGrounded || player.zVelocity != 0.0f;
+		slot.flying = player.isHunter && player.isPhantom;
+		if (!track.any || state.tick > track.newest) {
+			track.newest = state.tick;
+			track.any = true;
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// RENDER
+// -----------------------------------------------------------------------------
+
+void InterpolationBuffer::advance(Clock::time_point now) {
+	frameSeconds = (lastAdvance == Clock::time_point{}) ? 0.0 : std::chrono::duration<double>(now - lastAdvance).count();
+	lastAdvance = now;
+	// a late burst may pull the estimate back a little, wait for it rather than rewind
+	renderTick = std::max(renderTick, seconds(now) * TICKS_PER_SEC + offset - delay);
+}
+
+bool InterpolationBuffer::sample(int player, Pose& pose) {
+	Track& track = tracks[player];
+	if (!track.any) return false;
+	counters.samples++;
+
+	// A state arrived since a guess was drawn: carry on from where the player
+	// was drawn, and close the gap to where they really were over the blend
+	if (track.guessed && track.newest != track.drawnNewest) {
+		Pose then;
+		poseAt(track, track.drawnTick, then);
+		float gap[3] = { track.drawn.x - then.x, track.drawn.y - then.y, track.drawn.z - then.z };
+		// no sliding back across a teleport
+		bool teleported = sqrtf(gap[0] * gap[0] + gap[1] * gap[1] + gap[2] * gap[2]) > TELEPORT_SPEED;
+		for (int i = 0; i < 3; i++) {
+			track.blend[i] = teleported ? 0.0f : gap[i];
+		}
+	}
+	float keep = (float)std::exp(-frameSeconds / BLEND_SECONDS);
+	for (float& b : track.blend) {
+		b *= keep;
+	}
+
+	Source source = poseAt(track, renderTick, pose);
+	if (source == Source::EXTRAPOLATED) counters.extrapolated++;
+	if (source == Source::HELD) counters.held++;
+	pose.x += track.blend[0];
+	pose.y += track.blend[1];
+	pose.z += track.blend[2];
+
+	track.drawn = pose;
+	track.drawnTick = renderTick;
+	track.drawnNewest = track.newest;
+	track.guessed = source != Source::INTERPOLATED;
+	return true;
+}
+
+// the newest state kept from before `tick`
+const InterpolationBuffer::Sample* InterpolationBuffer::previous(const Track& track, uint64_t tick) const {
+	for (uint64_t back = 1; back < CAPACITY && back <= tick; back++) {
+		const Sample& sample = track.samples[(tick - back) % CAPACITY];
+		if (sample.tick == tick - back) return &sample;
+	}
+	return nullptr;
+}
+
+InterpolationBuffer::Source InterpolationBuffer::poseAt(const Track& track, double tick, Pose& pose) const {
+	const Sample& newest = track.samples[track.newest % CAPACITY];
+	if (tick >= (double)track.newest) {
+		// the state after is late, the player goes on the way they were going
+		double ahead = std::min(tick - (double)track.newest, MAX_EXTRAPOLATION_TICKS);
+		pose = newest.pose;
+
+		const Sample* before = previous(track, track.newest);
+		if (before) {
+			float ticks = (float)(track.newest - before->tick);
+			float vx = (newest.pose.x - before->pose.x) / ticks;
+			float vy = (newest.pose.y - before->pose.y) / ticks;
+			if (sqrtf(vx * vx + vy * vy) <= TELEPORT_SPEED) {
+				pose.x += vx * (float)ahead;
+				pose.y += vy * (float)ahead;
+			}
+		}
+
+		if (newest.flying) {
+			pose.z += newest.zVelocity * (float)ahead;
+		}
+		else if (newest.airborne) {
+			// the server takes GRAVITY off the velocity before each tick's move.
+			// Whatever they land on below the last state is not known here, so
+			// the arc rises and comes back down no further than that state.
+			pose.z += (float)(newest.zVelocity * ahead - GRAVITY * ahead * (ahead + 1.0) / 2.0);
+			pose.z = std::max(pose.z, newest.pose.z);
+		}
+		return (tick - (double)track.newest > MAX_EXTRAPOLATION_TICKS) ? Source::HELD : Source::EXTRAPOLATED;
+	}
+
+	// the newest state at or before `tick` and the oldest after it, stepping
+	// over ticks whose state was lost
+	const Sample* before = nullptr;
+	const Sample* after = nullptr;
+	for (uint64_t back = 0; back < CAPACITY && back <= track.newest; back++) {
+		const Sample& sample = track.samples[(track.newest - back) % CAPACITY];
+		if (sample.tick != track.newest - back) continue;
+		if ((double)sample.tick > tick) {
+			after = &sample;
+		}
+		else {
+			before = &sample;
+			break;
+		}
+	}
+	// `tick` is older than anything kept
+	if (!before) {
+		pose = after->pose;
+		return Source::INTERPOLATED;
+	}
+
+	const Pose& a = before->pose;
+	const Pose& b = after->pose;
+	float ticks = (float)(after->tick - before->tick);
+	float dx = b.x - a.x, dy = b.y - a.y, dz = b.z - a.z;
+	if (sqrtf(dx * dx + dy * dy + dz * dz) > TELEPORT_SPEED * ticks) {
+		// nothing to slide along, show the jump when its tick comes
+		pose = a;
+		return Source::INTERPOLATED;
+	}
+
+	float t = (float)((tick - (double)before->tick) / ticks);
+	// turn the short way round
+	float dyaw = remainderf(b.yaw - a.yaw, 2.0f * PI);
+	pose.x = a.x + dx * t;
+	pose.y = a.y + dy * t;
+	pose.z = a.z + dz * t;
+	pose.yaw = a.yaw + dyaw * t;
+	pose.pitch = a.pitch + (b.pitch - a.pitch) * t;
+	return Source::INTERPOLATED;
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "NetworkData.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <vector>
+
+// Boxes as six parallel float arrays (structure of arrays). This is only a
+// view: the floats live in a BoxStorage or straight in a mapped baked file.
+// Every array is padded with empty boxes up to a multiple of BOX_BATCH so the
+// batch kernels below never need a remainder loop; padding never overlaps.
+struct BoxArrays {
+	const float* minX = nullptr;
+	const float* minY = nullptr;
+	const float* minZ = nullptr;
+	const float* maxX = nullptr;
+	const float* maxY = nullptr;
+	const float* maxZ = nullptr;
+	size_t count = 0;
+
+	size_t size() const { return count; }
+	BoundingBox get(size_t i) const { return { minX[i], minY[i], minZ[i], maxX[i], maxY[i], maxZ[i] }; }
+};
+
+// Owns the arrays of boxes built at load time
+struct BoxStorage {
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+
+	void clear();
+	void push(const BoundingBox& b);
+	void pad();
+	size_t size() const { return minX.size(); }
+	BoxArrays view() const;
+};
+
+// Number of boxes tested by one call of the batch kernels
+static constexpr size_t BOX_BATCH = 8;
+
+// Tests `query` against boxes [first, first + BOX_BATCH) and returns a hit mask,
+// bit k set when box first + k overlaps (strictly, boxes that only touch do not).
+// The scalar version is the reference; overlapMask8 picks the widest kernel
+// the CPU supports (AVX2, else SSE2 on every x64 CPU).
+uint32_t overlapMask8Scalar(const BoundingBox& query, const BoxArrays& boxes, size_t first);
+uint32_t overlapMask8Sse(const BoundingBox& query, const BoxArrays& boxes, size_t first);
+uint32_t overlapMask8Avx2(const BoundingBox& query, const BoxArrays& boxes, size_t first);
+uint32_t overlapMask8(const BoundingBox& query, const BoxArrays& boxes, size_t first);
+bool cpuHasAvx2();
+
+// Earliest hit found by a point sweep
+struct PointSweep {
+	float t = 1.0f;      // fraction of the move, only hits below this are kept
+	int axis = -1;       // axis of the face that was hit
+	size_t index = 0;    // box index in the swept BoxArrays
+};
+
+// Sweeps the point `origin` along `delta` against boxes [first, first + BOX_BATCH)
+// and keeps the earliest entry in `best`. Only faces on axes set in `axisMask`
+// (bit 0 = x, 1 = y, 2 = z) count. Boxes already containing the point are skipped.
+// Same kernel set as overlapMask8: scalar reference, SSE2 and AVX2.
+void sweepPoint8Scalar(const float origin[3], const float delta[3], const BoxArrays& boxes, size_t first, uint32_t axisMask, PointSweep& best);
+void sweepPoint8Sse(const float origin[3], const float delta[3], const BoxArrays& boxes, size_t first, uint32_t axisMask, PointSweep& best);
+void sweepPoint8Avx2(const float origin[3], const float delta[3], const BoxArrays& boxes, size_t first, uint32_t axisMask, PointSweep& best);
+void sweepPoint8(const float origin[3], const float delta[3], const BoxArrays& boxes, size_t first, uint32_t axisMask, PointSweep& best);
+
+// Swept AABB test: `moving` travels by `delta` (x, y, z) against the static box
+// `target`. On a hit, returns true with `t` the fraction of the move where
+// the boxes first touch, in [0, 1], and `axis` the axis of the face that was hit.
+// Boxes that already overlap at t = 0 are not reported.
+bool sweepBox(const BoundingBox& moving, const float delta[3], const BoundingBox& target, float& t, int& axis);
+
+// Static collision for the level boxes (bb#_bboxes.json).
+//
+// A world is either built from the boxes at load time or mapped from a baked
+// file written by save(). The baked file holds the level boxes and every
+// layer with its grid exactly as they sit in memory, so load() only checks
+// the file and points the arrays at the mapping, with no parsing or copying:
+//   header | level boxes | layer table | per layer: boxes, cell offsets, cell ids, cell boxes
+// Sections start on 64 byte boundaries and all values are little endian.
+//
+// The level is stored once per player radius as a layer: a copy of every box
+// grown by that radius on all sides (the Minkowski sum with the player box),
+// so a player of that radius collides with the layer as a single point.
+// Each layer buckets its boxes into a uniform grid over the XY plane; a query
+// only visits the cells it touches, so the per-tick cost depends on how many
+// boxes are near the player instead of how many boxes are in the level.
+class CollisionWorld {
+public:
+	static constexpr float DEFAULT_CELL_SIZE = 0.25f;
+
+	// reads the {"name": {"min": [x, y, z], "max": [x, y, z]}} file exported from Blender
+	static bool readJson(const wchar_t* fileAddr, std::vector<BoundingBox>& out);
+
+	// builds one layer per entry of `radii`, layer i inflated by radii[i]
+	void build(const std::vector<BoundingBox>& boxes, const std::vector<float>& radii, float cellSize = DEFAULT_CELL_SIZE);
+
+	// writes the world as a baked collision file
+	bool save(const wchar_t* fileAddr) const;
+	// maps a baked collision file and uses it in place, false if it is missing or invalid
+	bool load(const wchar_t* fileAddr);
+	// level boxes the world was built from, before inflation
+	std::vector<BoundingBox> levelBoxes() const { return std::vector<BoundingBox>(level, level + count); }
+
+	// layer built for `radius`, -1 if there is none
+	int layerFor(float radius) const;
+
+	// Appends the indices of every box of `layer` that overlaps `area`, in
+	// ascending order and without duplicates.
+	void query(int layer, const BoundingBox& area, std::vector<uint32_t>& out);
+
+	// Sweeps a point along `delta` through `layer`, keeping the earliest hit below
+	// hit.t. Returns true if one was found; hit.index is then the box index.
+	bool sweepPoint(int layer, const float origin[3], const float delta[3], uint32_t axisMask, PointSweep& hit) const;
+
+	BoundingBox box(int layer, uint32_t i) const { return layers[layer].boxes.get(i); }
+	size_t size() const { return count; }
+	size_t layerCount() const { return layers.size(); }
+	float layerRadius(int layer) const { return layers[layer].radius; }
+	// all boxes of a layer in index order, padded for the batch kernels
+	const BoxArrays& allBoxes(int layer) const { return layers[layer].boxes; }
+
+private:
+	struct Layer {
+		float radius = 0;
+		BoxArrays boxes;
+
+		float originX = 0, originY = 0;
+		int cellsX = 0, cellsY = 0;
+
+		// Each cell owns a contiguous, padded block of box copies so a query can
+		// run the batch kernels straight over it: the boxes of cell c are
+		// cellBoxes[cellStart[c] .. cellStart[c + 1]) with ids in cellItems.
+		const uint32_t* cellStart = nullptr;
+		const uint32_t* cellItems = nullptr;
+		BoxArrays cellBoxes;
+
+		// storage behind the views above when the layer was built, not mapped
+		BoxStorage boxStore;
+		BoxStorage cellBoxStore;
+		std::vector<uint32_t> cellStartStore;
+		std::vector<uint32_t> cellItemsStore;
+	};
+
+	void buildLayer(Layer& layer, const std::vector<BoundingBox>& boxes);
+	// inclusive cell range covered by [lo, hi] along one axis, false if outside the grid
+	bool cellRange(float lo, float hi, float origin, int cells, int& first, int& last) const;
+
+	std::vector<Layer> layers;
+	const BoundingBox* level = nullptr;
+	size_t count = 0;
+	std::vector<BoundingBox> levelStore;
+	// baked file the views point into, empty when built
+	MappedFile file;
+	float cellSize = DEFAULT_CELL_SIZE;
+
+	// boxes spanning several cells are reported once per query
+	std::vector<uint32_t> lastSeen;
+	uint32_t queryStamp = 0;
+};
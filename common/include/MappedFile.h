@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a whole file mapped into memory (MapViewOfFile on Windows,
+// mmap elsewhere). Like DX::ReadData, a relative path not found in the
+// working directory is looked up next to the running exe (/proc/self/exe on
+// Linux).
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool open(const wchar_t* fileAddr);
+	void close();
+
+	const uint8_t* data() const { return ptr; }
+	size_t size() const { return len; }
+
+private:
+	const uint8_t* ptr = nullptr;
+	size_t len = 0;
+};
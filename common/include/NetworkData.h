@@ -47,7 +47,9 @@ enum class PacketType : uint32_t {
 	ANIMATION_STATE,
 	PHANTOM,
 	INSTINCT,
-	NOCTURNAL
+	NOCTURNAL,
+	SNAPSHOT,			// GameState delta, see Snapshot.h
+	SNAPSHOT_ACK		// client acknowledges a snapshot as its next baseline
 };
 
 // when adding powerups
@@ -155,6 +157,12 @@ struct PlayerState {
 	int jumpCounts; // for determining how many jumps can the player do in total
 	int availableJumps; // how many jumps are left for the player
 	bool dodgeCollide; // whether the player can collide with the boxes while dodging
+	// ticks the movement modifiers hold over, [from, until), so the client
+	// predicts them on the ticks the server applies them
+	uint32_t slowedFrom;   // hunter: wind-up of a swing over
+	uint32_t slowedUntil;  // hunter: cool-down of the swing over
+	uint32_t stunnedUntil; // hunter: the bear's stun over
+	uint32_t dodgingUntil; // survivor: dash over
 };
 
 struct EntityState { // this is for traps or placed objects
@@ -200,6 +208,8 @@ struct MovePayload {
 	float direction[3];
 	float yaw, pitch;
 	bool jump;
+	uint32_t sequence; // one a tick, counting up; the server acks the last one it applied
+	uint32_t viewTick; // server tick of the other players on screen, 0 when unknown
 };
 
 struct CameraPayload {
@@ -276,6 +286,10 @@ struct InstinctPayload {
 	uint64_t nextInstinctEnd;
 };
 
+struct SnapshotAckPayload {
+	uint32_t sequence;
+};
+
 struct Packet {
 	unsigned int packet_type;
 
@@ -288,14 +302,14 @@ struct Packet {
 	}
 };
 
-enum RunnerAnimation : UINT8 {
+enum RunnerAnimation : uint8_t {
 	RUNNER_ANIMATION_IDLE,
 	RUNNER_ANIMATION_WALK,
 	RUNNER_ANIMATION_DODGE,
 	RUNNER_ANIMATION_DEAD,
 	RUNNER_ANIMATION_COUNT,
 };
-enum HunterAnimation : UINT8 {
+enum HunterAnimation : uint8_t {
 	HUNTER_ANIMATION_IDLE,
 	HUNTER_ANIMATION_CHASE,
 	HUNTER_ANIMATION_ATTACK,
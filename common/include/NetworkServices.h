@@ -1,6 +1,36 @@
 #pragma once
+#if defined(_WIN32)
 #include <winsock2.h>
 #include <Windows.h>
+#else
+// POSIX sockets behind the Winsock names, so the server also builds on Linux
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+typedef unsigned long u_long;
+typedef pollfd WSAPOLLFD;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_BOTH SHUT_RDWR
+#define WSAEWOULDBLOCK EWOULDBLOCK
+
+inline int closesocket(SOCKET s) { return close(s); }
+inline int WSAGetLastError() { return errno; }
+inline int WSAPoll(WSAPOLLFD* fds, unsigned long count, int timeout) { return poll(fds, count, timeout); }
+inline int ioctlsocket(SOCKET s, unsigned long cmd, u_long* arg) {
+	int value = (int)*arg;
+	return ioctl(s, cmd, &value);
+}
+#endif
 #include "NetworkData.h"
 
 class NetworkServices {
@@ -10,6 +40,9 @@ public:
 	static int recvMessage(SOCKET curSocket, char* buffer, int bufSize);
 	static int recvAll (SOCKET curSocket, char* buffer, int n);
 	static bool checkMessage(SOCKET curSocket);
+	// One write of `count` buffers back to back, at most GATHER_MAX of them
+	static int sendGather(SOCKET curSocket, const char* const* parts, const int* lengths, int count);
+	static constexpr int GATHER_MAX = 64;
 
 	template<typename Payload>
 	static size_t buildPacket(PacketType type, const Payload& payload, char* buf) {
@@ -0,0 +1,45 @@
+#pragma once
+#include "NetworkData.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The bytes of one TCP stream, handed out as whole packets.
+//
+// recv() writes straight into the free space (writeSpan/commit) and packets
+// are read where they lie, so a packet is only copied when it wraps past the
+// end of the buffer; then it is put back together in a scratch buffer. A
+// packet may straddle any number of reads, its header included.
+class PacketRing {
+public:
+	// bytes buffered per connection at most, a power of two
+	static constexpr size_t CAPACITY = 16384;
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0 && CAPACITY >= MAX_PACKET_SIZE);
+
+	// One whole packet, header included. Valid until the next call on the ring.
+	struct View {
+		char* data;
+		uint32_t length;
+	};
+
+	// The free space to write to next, `length` 0 when the ring is full. Once
+	// the free space wraps around it takes two spans to fill.
+	char* writeSpan(size_t& length);
+	void commit(size_t length);
+
+	// The next whole packet, false when it has not fully arrived yet or the
+	// stream is corrupt
+	bool next(View& packet);
+	// a header with an impossible length came in, nothing after it can be framed
+	bool corrupt() const { return broken; }
+	size_t size() const { return (size_t)(head - tail); }
+
+private:
+	void copyOut(uint64_t from, char* to, size_t length) const;
+
+	std::vector<char> buf = std::vector<char>(CAPACITY);
+	uint64_t head = 0;    // bytes ever written
+	uint64_t tail = 0;    // bytes ever handed out
+	bool broken = false;
+	char scratch[MAX_PACKET_SIZE];
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include "NetworkData.h"
+#include "CollisionWorld.h"
+#include <cstdint>
+#include <vector>
+
+// One tick of a player's movement: the MOVE input, jumping, gravity and
+// collision with the level and the other players.
+//
+// The server steps every player with it each tick. The client steps its own
+// player with the same code as soon as it samples the input, so the player
+// moves without waiting a round trip, and replays its unacknowledged inputs
+// on top of every state the server sends. Both ends load the same level, so
+// they only disagree on what the client cannot know: another player's input,
+// a hit, a powerup running out.
+class PlayerMovement {
+public:
+	static constexpr int TICKS_PER_SEC = 64;
+	static constexpr float PLAYER_RADIUS = 1.0f * PLAYER_SCALING_FACTOR;
+	static constexpr float BEAR_HITBOX = 5.0f * PLAYER_SCALING_FACTOR;
+	static constexpr float BEAR_SPEED_MULTIPLIER = 0.75f;
+	static constexpr float BEAR_JUMP_BOOST = 1.0f * PLAYER_SCALING_FACTOR;
+	static constexpr float HUNTER_SLOW_FACTOR = 0.2f;
+
+	// What a step needs beyond the PlayerState. Both ends build them with
+	// modifiersAt(), from the windows the server keeps in the PlayerState.
+	struct Modifiers {
+		float extraJump = 0.0f;   // jump powerups
+		bool slowed = false;      // hunter winding up or recovering from a swing
+		bool stunned = false;     // hunter the bear ran into, cannot move
+		bool dodging = false;     // dashing through the sides of boxes
+	};
+
+	// What happened during a step, for the server to act on
+	struct Result {
+		bool jumped = false;
+		bool bearImpact = false;  // the player was a bear and ran into the hunter
+	};
+
+	// Loads the level collision from a baked file, falling back to the JSON
+	// export (and baking it) when the baked file is missing, stale or was baked
+	// for other player sizes. Also swaps maps while the game is running.
+	bool loadCollision(const wchar_t* bakedAddr, const wchar_t* jsonAddr);
+	// converts a JSON export into a baked collision file, returns the exit code
+	static int bakeCollision(const wchar_t* jsonAddr, const wchar_t* bakedAddr);
+	bool loaded() const { return playerLayer >= 0; }
+
+	// The modifiers `player` moves with on `tick`, `extraJump` from its jump powerups
+	static Modifiers modifiersAt(const PlayerState& player, uint64_t tick, float extraJump);
+
+	// Moves players[id] by one tick of `input`, or of gravity alone when it is
+	// null, colliding with the level and the other players of `players`.
+	Result step(PlayerState* players, int count, unsigned int id, const MovePayload* input, const Modifiers& modifiers);
+
+private:
+	// gap kept between a player and whatever stopped them
+	static constexpr float COLLISION_SKIN = 1e-5f;
+
+	void moveWithCollision(PlayerState* players, int count, unsigned int id, const float move[3], const Modifiers& modifiers, Result& result);
+
+	// static level boxes, bucketed for broad-phase queries
+	CollisionWorld collision;
+	// level layers grown by the player and bear radius
+	int playerLayer = -1;
+	int bearLayer = -1;
+	// scratch list of boxes the player being resolved is inside
+	std::vector<uint32_t> candidates;
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include "NetworkData.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// GameState snapshots sent as a delta against the last state the client
+// acknowledged with SNAPSHOT_ACK, so a player standing still costs nothing
+// and a moving one only the fields that changed. SNAPSHOT payload, packed
+// bit by bit with no padding:
+//
+//   varint sequence | varint sequence - baseline sequence (0: keyframe)
+//   varint tick - baseline tick | varint input sequence | 5 changed bits
+//   [timerFrac] | players
+//
+// The input sequence is the last MovePayload::sequence from the receiving
+// client that the state includes, which the client predicts on from.
+// Varints are 7 bits a group plus a continuation bit. Changed bit 0 flags
+// timerFrac, bits 1..4 players 0..3. Every changed player is a 15 bit Field
+// mask followed by those fields in Field order, quantized as below. A
+// keyframe is a delta against an all-zero state. Fields are compared after
+// quantizing, so drift too small to send never marks a field changed.
+namespace Snapshot {
+	enum Field : uint16_t {
+		X               = 1 << 0,
+		Y               = 1 << 1,
+		Z               = 1 << 2,
+		YAW             = 1 << 3,
+		PITCH           = 1 << 4,
+		Z_VELOCITY      = 1 << 5,
+		SPEED           = 1 << 6,
+		COINS           = 1 << 7,
+		FLAGS           = 1 << 8,    // every bool, one bit each
+		JUMP_COUNTS     = 1 << 9,
+		AVAILABLE_JUMPS = 1 << 10,
+		SLOWED_FROM     = 1 << 11,
+		SLOWED_UNTIL    = 1 << 12,
+		STUNNED_UNTIL   = 1 << 13,
+		DODGING_UNTIL   = 1 << 14,
+	};
+	static constexpr int FIELD_COUNT = 15;
+
+	// Positions are fixed point over the level (bb#_bboxes.json spans about
+	// x -3..3, y -2.1..3.8, z -0.6..3.5) with room to fall below the floor
+	static constexpr float WORLD_MIN[3] = { -4.0f, -4.0f, -6.0f };
+	static constexpr float WORLD_MAX[3] = { 4.0f, 4.0f, 4.0f };
+	static constexpr int POSITION_BITS = 16;   // steps of 1.2e-4 across 8 units
+	static constexpr int YAW_BITS = 16;        // wrapped to one turn
+	static constexpr int PITCH_BITS = 14;      // -90..90 degrees
+	static constexpr int TIMER_BITS = 16;
+	// zVelocity and speed go as raw floats, coins and jumps as bytes, the
+	// modifier windows as whole ticks (they change once an action, not a tick)
+	static constexpr int FIELD_BITS[FIELD_COUNT] = {
+		POSITION_BITS, POSITION_BITS, POSITION_BITS, YAW_BITS, PITCH_BITS, 32, 32, 8, 6, 8, 8, 32, 32, 32, 32,
+	};
+
+	// baselines both ends keep, an ack older than this gets a keyframe
+	static constexpr uint32_t HISTORY = 64;
+	// largest payload encode() writes: four varints, then every field
+	static constexpr size_t MAX_SIZE = 5 + 5 + 10 + 5 +
+		(5 + TIMER_BITS + 4 * (FIELD_COUNT + POSITION_BITS * 3 + YAW_BITS + PITCH_BITS + 32 + 32 + 8 + 6 + 8 + 8 + 4 * 32) + 7) / 8;
+
+	// Writes `state` as a delta against `base`, a keyframe when `base` is
+	// null, to `out` (MAX_SIZE bytes). Returns the payload size.
+	size_t encode(const GameState& state, uint32_t sequence, const GameState* base, uint32_t baseSequence,
+		uint32_t inputSequence, uint8_t* out);
+}
+
+// The last Snapshot::HISTORY states sent (server) or received (client), by
+// sequence number
+class SnapshotHistory {
+public:
+	void push(uint32_t sequence, const GameState& state);
+	// null when `sequence` was never pushed or has been overwritten
+	const GameState* find(uint32_t sequence) const;
+
+	// Reads a SNAPSHOT payload into `state`, `sequence` and `inputSequence`.
+	// False when the payload is malformed or its baseline is no longer kept here.
+	bool decode(const uint8_t* data, size_t length, GameState& state, uint32_t& sequence, uint32_t& inputSequence) const;
+
+private:
+	struct Entry {
+		uint32_t sequence = 0;    // 0: empty, sequences start at 1
+		GameState state{};
+	};
+	std::array<Entry, Snapshot::HISTORY> entries{};
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include "NetworkServices.h"
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+// Game packets over UDP. Packets that go out again every tick anyway
+// (snapshots, animation state, MOVE and CAMERA input) use an unreliable
+// sequenced channel: a late one is dropped instead of waited for, so one lost
+// datagram never holds up the packets behind it the way a lost TCP segment
+// does. MOVE is the exception on the receiving side, every copy is delivered
+// and the server's input queue reorders it by its own sequence number.
+// Everything else uses a reliable ordered channel with acks and resends.
+enum class Channel : uint8_t {
+	UNRELIABLE,
+	RELIABLE,
+};
+
+Channel channelOf(PacketType type);
+
+// milliseconds on a steady clock, the time base of everything below
+uint64_t udpNowMs();
+
+// Drops and delays outgoing datagrams, to try the transport on loopback.
+// Jitter reorders datagrams as well.
+struct LossSimulator {
+	float lossPercent = 0.0f;
+	uint32_t latencyMs = 0;
+	uint32_t jitterMs = 0;
+};
+
+// A non-blocking UDP socket
+class UdpSocket {
+public:
+	~UdpSocket();
+
+	// binds to `port` on every interface, 0 for any free port
+	bool open(uint16_t port);
+	uint16_t port() const;
+	SOCKET handle() const { return sock; }
+	void simulate(const LossSimulator& loss, uint32_t seed);
+
+	void sendTo(const sockaddr_in& to, const uint8_t* data, size_t length);
+	// the next waiting datagram, false when there is none
+	bool receive(sockaddr_in& from, std::vector<uint8_t>& datagram);
+	// sends the delayed datagrams that are due
+	void flush(uint64_t nowMs);
+	// sendto() calls made so far
+	uint64_t sendCalls() const { return calls; }
+
+private:
+	void transmit(const sockaddr_in& to, const uint8_t* data, size_t length);
+
+	SOCKET sock = INVALID_SOCKET;
+	uint64_t calls = 0;
+	bool simulating = false;
+	LossSimulator loss;
+	std::mt19937 gen;
+	struct Delayed {
+		uint64_t dueMs;
+		sockaddr_in to;
+		std::vector<uint8_t> data;
+	};
+	std::vector<Delayed> delayed;
+};
+
+// One end of a connection, with no socket of its own: game packets go in
+// through send() and datagrams come out in `outgoing`, datagrams go in
+// through receive() and game packets come out in order.
+//
+// Datagram: 'T' 'T' | u16 sequence | u16 ack | u32 ack bits | u8 channel
+// [| u16 reliable message id] | one game packet. Every datagram acks the
+// newest sequence received and, bit by bit, the 32 before it. A reliable
+// packet is resent in a new datagram until one carrying it is acked.
+class UdpConnection {
+public:
+	static constexpr uint32_t RESEND_MIN_MS = 30;
+	static constexpr uint32_t RESEND_MAX_MS = 500;
+	// a peer silent for this long is gone
+	static constexpr uint32_t TIMEOUT_MS = 10000;
+	static constexpr size_t MAX_DATAGRAM = 13 + MAX_PACKET_SIZE;
+
+	struct Stats {
+		uint64_t datagramsSent = 0;
+		uint64_t datagramsReceived = 0;
+		uint64_t resent = 0;
+		uint64_t stale = 0;         // unreliable packets older than one already delivered, never MOVE
+		uint64_t duplicates = 0;
+		float rttMs = 100.0f;       // smoothed
+	};
+
+	explicit UdpConnection(uint64_t nowMs = udpNowMs());
+
+	// queues every game packet in `data`, each starting with its PacketHeader
+	void send(const char* data, int length, uint64_t nowMs);
+	// Reads one datagram, appending the game packets it makes deliverable to
+	// `delivered`. False when it is not one of ours.
+	bool receive(const uint8_t* datagram, size_t length, uint64_t nowMs, std::vector<char>& delivered);
+	// resends reliable packets that went unacked for too long, then acks what
+	// came in if nothing else went out since
+	void update(uint64_t nowMs);
+	bool timedOut(uint64_t nowMs) const { return nowMs - lastReceiveMs > TIMEOUT_MS; }
+	const Stats& stats() const { return counters; }
+
+	// datagrams for the socket, the owner sends and clears them
+	std::vector<std::vector<uint8_t>> outgoing;
+
+private:
+	static constexpr uint8_t ACK_ONLY = 2;
+	static constexpr uint8_t HAS_ACK = 0x80;   // channel flag, set once anything was received
+	static constexpr uint16_t SENT_WINDOW = 1024;
+	static constexpr uint16_t RECEIVE_WINDOW = 1024;
+
+	void transmit(uint8_t channel, uint16_t messageId, const char* packet, uint32_t length, uint64_t nowMs);
+	void acked(uint16_t sequence, uint64_t nowMs);
+	void deliverReliable(uint16_t messageId, const char* packet, uint32_t length, std::vector<char>& delivered);
+
+	uint16_t localSequence = 0;
+	bool haveRemote = false;
+	uint16_t remoteSequence = 0;
+	uint32_t remoteBits = 0;
+	uint64_t remoteExtended = 0;  // remoteSequence counting the wraps
+	bool ackOwed = false;
+	uint64_t lastReceiveMs;
+
+	struct Sent {
+		bool used = false;
+		bool acked = false;
+		bool reliable = false;
+		uint16_t sequence = 0;
+		uint16_t messageId = 0;
+		uint64_t sentMs = 0;
+	};
+	std::vector<Sent> sent = std::vector<Sent>(SENT_WINDOW);
+
+	struct Pending {
+		std::vector<char> packet;
+		uint64_t lastSentMs;
+	};
+	uint16_t nextMessageId = 0;
+	std::map<uint16_t, Pending> pending;            // reliable, not acked yet
+
+	uint16_t nextDeliverId = 0;
+	std::map<uint16_t, std::vector<char>> early;    // reliable, waiting on an earlier one
+	// packet type -> extended sequence last delivered; 16 bits would turn a
+	// type unsent for half the sequence space into one that looks newer
+	std::map<uint32_t, uint64_t> newestUnreliable;
+
+	Stats counters;
+};
@@ -0,0 +1,726 @@
+#include "CollisionWorld.h"
+#include "Parson.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// -----------------------------------------------------------------------------
+// BOX ARRAYS
+// -----------------------------------------------------------------------------
+
+void BoxStorage::clear() {
+	minX.clear(); minY.clear(); minZ.clear();
+	maxX.clear(); maxY.clear(); maxZ.clear();
+}
+
+void BoxStorage::push(const BoundingBox& b) {
+	minX.push_back(b.minX); minY.push_back(b.minY); minZ.push_back(b.minZ);
+	maxX.push_back(b.maxX); maxY.push_back(b.maxY); maxZ.push_back(b.maxZ);
+}
+
+void BoxStorage::pad() {
+	// min above max on every axis: nothing can overlap it
+	constexpr float inf = std::numeric_limits<float>::infinity();
+	while (size() % BOX_BATCH != 0) {
+		push({ inf, inf, inf, -inf, -inf, -inf });
+	}
+}
+
+BoxArrays BoxStorage::view() const {
+	return { minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), size() };
+}
+
+// -----------------------------------------------------------------------------
+// BATCH OVERLAP KERNELS
+// -----------------------------------------------------------------------------
+
+uint32_t overlapMask8Scalar(const BoundingBox& q, const BoxArrays& b, size_t first) {
+	uint32_t mask = 0;
+	for (size_t k = 0; k < BOX_BATCH; k++) {
+		size_t i = first + k;
+		bool hit =
+			(q.minX < b.maxX[i] && q.maxX > b.minX[i]) &&
+			(q.minY < b.maxY[i] && q.maxY > b.minY[i]) &&
+			(q.minZ < b.maxZ[i] && q.maxZ > b.minZ[i]);
+		mask |= (uint32_t)hit << k;
+	}
+	return mask;
+}
+
+static inline __m128 overlap4(const BoundingBox& q, const BoxArrays& b, size_t i) {
+	__m128 hit = _mm_and_ps(
+		_mm_cmplt_ps(_mm_set1_ps(q.minX), _mm_loadu_ps(&b.maxX[i])),
+		_mm_cmpgt_ps(_mm_set1_ps(q.maxX), _mm_loadu_ps(&b.minX[i])));
+	hit = _mm_and_ps(hit, _mm_cmplt_ps(_mm_set1_ps(q.minY), _mm_loadu_ps(&b.maxY[i])));
+	hit = _mm_and_ps(hit, _mm_cmpgt_ps(_mm_set1_ps(q.maxY), _mm_loadu_ps(&b.minY[i])));
+	hit = _mm_and_ps(hit, _mm_cmplt_ps(_mm_set1_ps(q.minZ), _mm_loadu_ps(&b.maxZ[i])));
+	hit = _mm_and_ps(hit, _mm_cmpgt_ps(_mm_set1_ps(q.maxZ), _mm_loadu_ps(&b.minZ[i])));
+	return hit;
+}
+
+uint32_t overlapMask8Sse(const BoundingBox& q, const BoxArrays& b, size_t first) {
+	uint32_t lo = (uint32_t)_mm_movemask_ps(overlap4(q, b, first));
+	uint32_t hi = (uint32_t)_mm_movemask_ps(overlap4(q, b, first + 4));
+	return lo | (hi << 4);
+}
+
+TARGET_AVX2 uint32_t overlapMask8Avx2(const BoundingBox& q, const BoxArrays& b, size_t i) {
+	__m256 hit = _mm256_and_ps(
+		_mm256_cmp_ps(_mm256_set1_ps(q.minX), _mm256_loadu_ps(&b.maxX[i]), _CMP_LT_OQ),
+		_mm256_cmp_ps(_mm256_set1_ps(q.maxX), _mm256_loadu_ps(&b.minX[i]), _CMP_GT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_set1_ps(q.minY), _mm256_loadu_ps(&b.maxY[i]), _CMP_LT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_set1_ps(q.maxY), _mm256_loadu_ps(&b.minY[i]), _CMP_GT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_set1_ps(q.minZ), _mm256_loadu_ps(&b.maxZ[i]), _CMP_LT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_set1_ps(q.maxZ), _mm256_loadu_ps(&b.minZ[i]), _CMP_GT_OQ));
+	return (uint32_t)_mm256_movemask_ps(hit);
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 1);
+	bool osxsave = (regs[2] & (1 << 27)) != 0;
+	if (!osxsave) return false;
+	// the OS must save the YMM registers on context switch
+	if ((_xgetbv(0) & 0x6) != 0x6) return false;
+	__cpuidex(regs, 7, 0);
+	return (regs[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+uint32_t overlapMask8(const BoundingBox& q, const BoxArrays& b, size_t first) {
+	static const bool avx2 = cpuHasAvx2();
+	return avx2 ? overlapMask8Avx2(q, b, first) : overlapMask8Sse(q, b, first);
+}
+
+// -----------------------------------------------------------------------------
+// BATCH POINT SWEEP KERNELS
+// -----------------------------------------------------------------------------
+//
+// Slab method for a point against eight boxes at once. Every kernel computes
+// the same float operations in the same order (including 1 / delta done once
+// up front), so they agree bit for bit and pick the same box on ties: the
+// earliest t, then the lowest index.
+
+void sweepPoint8Scalar(const float o[3], const float d[3], const BoxArrays& b, size_t first, uint32_t axisMask, PointSweep& best) {
+	const float* mins[3] = { b.minX, b.minY, b.minZ };
+	const float* maxs[3] = { b.maxX, b.maxY, b.maxZ };
+	float inv[3];
+	for (int a = 0; a < 3; a++) {
+		inv[a] = (d[a] != 0) ? 1.0f / d[a] : 0.0f;
+	}
+
+	for (size_t k = 0; k < BOX_BATCH; k++) {
+		size_t i = first + k;
+		float entry = -std::numeric_limits<float>::infinity();
+		float exit = std::numeric_limits<float>::infinity();
+		int entryAxis = -1;
+		bool miss = false;
+		for (int a = 0; a < 3; a++) {
+			if (d[a] == 0) {
+				// not moving on this axis: must already be inside the slab
+				if (o[a] <= mins[a][i] || o[a] >= maxs[a][i]) miss = true;
+				continue;
+			}
+			float t1 = (mins[a][i] - o[a]) * inv[a];
+			float t2 = (maxs[a][i] - o[a]) * inv[a];
+			float enter = std::min(t1, t2);
+			float leave = std::max(t1, t2);
+			if (enter > entry) {
+				entry = enter;
+				entryAxis = a;
+			}
+			exit = std::min(exit, leave);
+		}
+		if (miss || entryAxis < 0 || !(entry < exit) || entry < 0 || !(entry < best.t)) continue;
+		if (((axisMask >> entryAxis) & 1) == 0) continue;
+		best.t = entry;
+		best.axis = entryAxis;
+		best.index = i;
+	}
+}
+
+// picks the lanes set in `valid`, lowest lane first, in the same order as the scalar loop
+static inline void keepEarliest(uint32_t valid, const float* entry, const float* axis, size_t first, uint32_t axisMask, PointSweep& best) {
+	while (valid) {
+		int k = std::countr_zero(valid);
+		valid &= valid - 1;
+		int a = (int)axis[k];
+		if (((axisMask >> a) & 1) == 0 || !(entry[k] < best.t)) continue;
+		best.t = entry[k];
+		best.axis = a;
+		best.index = first + k;
+	}
+}
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// returns the lanes hit during the move; entry t and axis are stored per lane
+static inline uint32_t sweepPoint4(const float o[3], const float d[3], const float inv[3], const BoxArrays& b, size_t i, float* entryOut, float* axisOut) {
+	const float* mins[3] = { b.minX, b.minY, b.minZ };
+	const float* maxs[3] = { b.maxX, b.maxY, b.maxZ };
+	__m128 entry = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+	__m128 exit = _mm_set1_ps(std::numeric_limits<float>::infinity());
+	__m128 axis = _mm_set1_ps(-1.0f);
+	__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int a = 0; a < 3; a++) {
+		__m128 lo = _mm_loadu_ps(&mins[a][i]);
+		__m128 hi = _mm_loadu_ps(&maxs[a][i]);
+		__m128 p = _mm_set1_ps(o[a]);
+		if (d[a] == 0) {
+			inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(p, lo), _mm_cmplt_ps(p, hi)));
+			continue;
+		}
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(lo, p), _mm_set1_ps(inv[a]));
+		__m128 t2 = _mm_mul_ps(_mm_sub_ps(hi, p), _mm_set1_ps(inv[a]));
+		__m128 enter = _mm_min_ps(t1, t2);
+		__m128 later = _mm_cmpgt_ps(enter, entry);
+		entry = select4(later, enter, entry);
+		axis = select4(later, _mm_set1_ps((float)a), axis);
+		exit = _mm_min_ps(exit, _mm_max_ps(t1, t2));
+	}
+	__m128 hit = _mm_and_ps(inside, _mm_cmpge_ps(axis, _mm_setzero_ps()));
+	hit = _mm_and_ps(hit, _mm_cmplt_ps(entry, exit));
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(entry, _mm_setzero_ps()));
+	_mm_storeu_ps(entryOut, entry);
+	_mm_storeu_ps(axisOut, axis);
+	return (uint32_t)_mm_movemask_ps(hit);
+}
+
+void sweepPoint8Sse(const float o[3], const float d[3], const BoxArrays& b, size_t first, uint32_t axisMask, PointSweep& best) {
+	float inv[3];
+	for (int a = 0; a < 3; a++) {
+		inv[a] = (d[a] != 0) ? 1.0f / d[a] : 0.0f;
+	}
+	float entry[BOX_BATCH], axis[BOX_BATCH];
+	uint32_t lo = sweepPoint4(o, d, inv, b, first, entry, axis);
+	uint32_t hi = sweepPoint4(o, d, inv, b, first + 4, entry + 4, axis + 4);
+	keepEarliest(lo | (hi << 4), entry, axis, first, axisMask, best);
+}
+
+TARGET_AVX2 void sweepPoint8Avx2(const float o[3], const float d[3], const BoxArrays& b, size_t i, uint32_t axisMask, PointSweep& best) {
+	const float* mins[3] = { b.minX, b.minY, b.minZ };
+	const float* maxs[3] = { b.maxX, b.maxY, b.maxZ };
+	__m256 entry = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	__m256 exit = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+	__m256 axis = _mm256_set1_ps(-1.0f);
+	__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	for (int a = 0; a < 3; a++) {
+		__m256 lo = _mm256_loadu_ps(&mins[a][i]);
+		__m256 hi = _mm256_loadu_ps(&maxs[a][i]);
+		__m256 p = _mm256_set1_ps(o[a]);
+		if (d[a] == 0) {
+			inside = _mm256_and_ps(inside, _mm256_and_ps(
+				_mm256_cmp_ps(p, lo, _CMP_GT_OQ), _mm256_cmp_ps(p, hi, _CMP_LT_OQ)));
+			continue;
+		}
+		__m256 inv = _mm256_set1_ps(1.0f / d[a]);
+		__m256 t1 = _mm256_mul_ps(_mm256_sub_ps(lo, p), inv);
+		__m256 t2 = _mm256_mul_ps(_mm256_sub_ps(hi, p), inv);
+		__m256 enter = _mm256_min_ps(t1, t2);
+		__m256 later = _mm256_cmp_ps(enter, entry, _CMP_GT_OQ);
+		entry = _mm256_blendv_ps(entry, enter, later);
+		axis = _mm256_blendv_ps(axis, _mm256_set1_ps((float)a), later);
+		exit = _mm256_min_ps(exit, _mm256_max_ps(t1, t2));
+	}
+	__m256 hit = _mm256_and_ps(inside, _mm256_cmp_ps(axis, _mm256_setzero_ps(), _CMP_GE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(entry, exit, _CMP_LT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(entry, _mm256_setzero_ps(), _CMP_GE_OQ));
+	uint32_t valid = (uint32_t)_mm256_movemask_ps(hit);
+	if (!valid) return;
+
+	float entryLanes[BOX_BATCH], axisLanes[BOX_BATCH];
+	_mm256_storeu_ps(entryLanes, entry);
+	_mm256_storeu_ps(axisLanes, axis);
+	keepEarliest(valid, entryLanes, axisLanes, i, axisMask, best);
+}
+
+void sweepPoint8(const float o[3], const float d[3], const BoxArrays& b, size_t first, uint32_t axisMask, PointSweep& best) {
+	static const bool avx2 = cpuHasAvx2();
+	if (avx2) sweepPoint8Avx2(o, d, b, first, axisMask, best);
+	else sweepPoint8Sse(o, d, b, first, axisMask, best);
+}
+
+// -----------------------------------------------------------------------------
+// SWEPT TEST
+// -----------------------------------------------------------------------------
+
+bool sweepBox(const BoundingBox& moving, const float delta[3], const BoundingBox& target, float& t, int& axis) {
+	const float movingMin[3] = { moving.minX, moving.minY, moving.minZ };
+	const float movingMax[3] = { moving.maxX, moving.maxY, moving.maxZ };
+	const float targetMin[3] = { target.minX, target.minY, target.minZ };
+	const float targetMax[3] = { target.maxX, target.maxY, target.maxZ };
+
+	// the boxes overlap during [entry, exit), found per axis with the slab method
+	float entry = -std::numeric_limits<float>::infinity();
+	float exit = std::numeric_limits<float>::infinity();
+	int entryAxis = -1;
+	for (int i = 0; i < 3; i++) {
+		if (delta[i] == 0) {
+			// not moving on this axis: must already overlap on it
+			if (movingMax[i] <= targetMin[i] || movingMin[i] >= targetMax[i]) return false;
+			continue;
+		}
+		float enter, leave;
+		if (delta[i] > 0) {
+			enter = (targetMin[i] - movingMax[i]) / delta[i];
+			leave = (targetMax[i] - movingMin[i]) / delta[i];
+		}
+		else {
+			enter = (targetMax[i] - movingMin[i]) / delta[i];
+			leave = (targetMin[i] - movingMax[i]) / delta[i];
+		}
+		if (enter > entry) {
+			entry = enter;
+			entryAxis = i;
+		}
+		exit = std::min(exit, leave);
+	}
+
+	// no contact during the move, only touching edges, or already overlapping
+	if (entryAxis < 0 || entry >= exit || entry < 0 || entry > 1) return false;
+	t = entry;
+	axis = entryAxis;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// COLLISION WORLD
+// -----------------------------------------------------------------------------
+
+bool CollisionWorld::readJson(const wchar_t* fileAddr, std::vector<BoundingBox>& out) {
+	MappedFile file;
+	if (!file.open(fileAddr)) {
+		fprintf(stderr, "Cannot read file %ls\n", fileAddr);
+		return false;
+	}
+
+	// the parser wants a terminated string
+	std::string text(reinterpret_cast<const char*>(file.data()), file.size());
+	JSON_Value* rootVal = json_parse_string(text.c_str());
+
+	if (!rootVal) {
+		fprintf(stderr, "Cannot parse %ls\n", fileAddr);
+		return false;
+	}
+	printf("Parsed %ls\n", fileAddr);
+
+	JSON_Object* rootObj = json_value_get_object(rootVal);
+	size_t       boxCnt = json_object_get_count(rootObj);
+	out.reserve(out.size() + boxCnt);
+
+	for (size_t i = 0; i < boxCnt; i++) {
+		const char* name = json_object_get_name(rootObj, i);
+		JSON_Object* o = json_object_get_object(rootObj, name);
+		JSON_Array* mn = json_object_get_array(o, "min");
+		JSON_Array* mx = json_object_get_array(o, "max");
+
+		// raw Blender coords: {min.x, min.y, min.z, max.x, max.y, max.z}
+		out.push_back({
+			(float)json_array_get_number(mn, 0),
+			(float)json_array_get_number(mn, 1),
+			(float)json_array_get_number(mn, 2),
+			(float)json_array_get_number(mx, 0),
+			(float)json_array_get_number(mx, 1),
+			(float)json_array_get_number(mx, 2),
+		});
+	}
+	json_value_free(rootVal);
+	return true;
+}
+
+void CollisionWorld::build(const std::vector<BoundingBox>& levelBoxes, const std::vector<float>& radii, float size) {
+	file.close();
+	levelStore = levelBoxes;
+	level = levelStore.data();
+	count = levelBoxes.size();
+	cellSize = size;
+	lastSeen.assign(count, 0);
+	queryStamp = 0;
+
+	// Minkowski sum of every box with the cube of each radius, done once here
+	// so nothing has to be inflated while the game is running
+	layers.assign(radii.size(), Layer());
+	std::vector<BoundingBox> grown(levelBoxes.size());
+	for (size_t l = 0; l < radii.size(); l++) {
+		float r = radii[l];
+		for (size_t i = 0; i < levelBoxes.size(); i++) {
+			const BoundingBox& b = levelBoxes[i];
+			grown[i] = { b.minX - r, b.minY - r, b.minZ - r, b.maxX + r, b.maxY + r, b.maxZ + r };
+		}
+		layers[l].radius = r;
+		buildLayer(layers[l], grown);
+		printf("[COLLISION] layer %zu: radius %.4f, %dx%d grid (%zu cell entries)\n",
+			l, r, layers[l].cellsX, layers[l].cellsY, layers[l].cellBoxes.size());
+	}
+
+	printf("[COLLISION] %zu boxes in %zu layers (%s kernel)\n",
+		count, layers.size(), cpuHasAvx2() ? "AVX2" : "SSE2");
+}
+
+void CollisionWorld::buildLayer(Layer& layer, const std::vector<BoundingBox>& levelBoxes) {
+	layer.boxStore.clear();
+	for (const BoundingBox& b : levelBoxes) {
+		layer.boxStore.push(b);
+	}
+	layer.boxStore.pad();
+	layer.boxes = layer.boxStore.view();
+
+	std::vector<uint32_t>& cellStart = layer.cellStartStore;
+	std::vector<uint32_t>& cellItems = layer.cellItemsStore;
+	BoxStorage& cellBoxes = layer.cellBoxStore;
+	cellItems.clear();
+	cellBoxes.clear();
+	if (levelBoxes.empty()) {
+		layer.cellsX = layer.cellsY = 0;
+		cellStart.assign(1, 0);
+	}
+	else {
+		// grid covers the XY extent of every box
+		float minX = levelBoxes[0].minX, minY = levelBoxes[0].minY;
+		float maxX = levelBoxes[0].maxX, maxY = levelBoxes[0].maxY;
+		for (const BoundingBox& b : levelBoxes) {
+			minX = std::min(minX, b.minX);
+			minY = std::min(minY, b.minY);
+			maxX = std::max(maxX, b.maxX);
+			maxY = std::max(maxY, b.maxY);
+		}
+		layer.originX = minX;
+		layer.originY = minY;
+		layer.cellsX = std::max(1, (int)std::ceil((maxX - minX) / cellSize));
+		layer.cellsY = std::max(1, (int)std::ceil((maxY - minY) / cellSize));
+
+		// collect the boxes of every cell, then lay the cells out back to back
+		std::vector<std::vector<uint32_t>> cells(layer.cellsX * layer.cellsY);
+		for (uint32_t i = 0; i < (uint32_t)levelBoxes.size(); i++) {
+			const BoundingBox& b = levelBoxes[i];
+			int x0, x1, y0, y1;
+			cellRange(b.minX, b.maxX, layer.originX, layer.cellsX, x0, x1);
+			cellRange(b.minY, b.maxY, layer.originY, layer.cellsY, y0, y1);
+			for (int y = y0; y <= y1; y++)
+				for (int x = x0; x <= x1; x++)
+					cells[y * layer.cellsX + x].push_back(i);
+		}
+
+		cellStart.assign(layer.cellsX * layer.cellsY + 1, 0);
+		for (int c = 0; c < layer.cellsX * layer.cellsY; c++) {
+			for (uint32_t i : cells[c]) {
+				cellItems.push_back(i);
+				cellBoxes.push(levelBoxes[i]);
+			}
+			// pad every cell so its block starts on a batch boundary
+			cellBoxes.pad();
+			cellItems.resize(cellBoxes.size(), UINT32_MAX);
+			cellStart[c + 1] = (uint32_t)cellBoxes.size();
+		}
+	}
+
+	layer.cellStart = cellStart.data();
+	layer.cellItems = cellItems.data();
+	layer.cellBoxes = cellBoxes.view();
+}
+
+int CollisionWorld::layerFor(float radius) const {
+	for (size_t l = 0; l < layers.size(); l++) {
+		if (std::fabs(layers[l].radius - radius) < 1e-6f) return (int)l;
+	}
+	return -1;
+}
+
+bool CollisionWorld::cellRange(float lo, float hi, float origin, int cells, int& first, int& last) const {
+	first = (int)std::floor((lo - origin) / cellSize);
+	last = (int)std::floor((hi - origin) / cellSize);
+	if (last < 0 || first >= cells) {
+		return false;
+	}
+	first = std::clamp(first, 0, cells - 1);
+	last = std::clamp(last, 0, cells - 1);
+	return true;
+}
+
+void CollisionWorld::query(int layer, const BoundingBox& area, std::vector<uint32_t>& out) {
+	const Layer& l = layers[layer];
+	int x0, x1, y0, y1;
+	if (!cellRange(area.minX, area.maxX, l.originX, l.cellsX, x0, x1) ||
+		!cellRange(area.minY, area.maxY, l.originY, l.cellsY, y0, y1)) {
+		return;
+	}
+
+	// the stamp wrapped around, forget every box seen so far
+	if (++queryStamp == 0) {
+		std::fill(lastSeen.begin(), lastSeen.end(), 0);
+		queryStamp = 1;
+	}
+
+	size_t first = out.size();
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			int c = y * l.cellsX + x;
+			for (uint32_t k = l.cellStart[c]; k < l.cellStart[c + 1]; k += BOX_BATCH) {
+				uint32_t mask = overlapMask8(area, l.cellBoxes, k);
+				while (mask) {
+					uint32_t i = l.cellItems[k + std::countr_zero(mask)];
+					mask &= mask - 1;
+					if (lastSeen[i] == queryStamp) continue;
+					lastSeen[i] = queryStamp;
+					out.push_back(i);
+				}
+			}
+		}
+	}
+	// keep the same order as a full scan so resolution stays identical
+	std::sort(out.begin() + first, out.end());
+}
+
+bool CollisionWorld::sweepPoint(int layer, const float o[3], const float d[3], uint32_t axisMask, PointSweep& hit) const {
+	const Layer& l = layers[layer];
+	int x0, x1, y0, y1;
+	if (!cellRange(std::min(o[0], o[0] + d[0]), std::max(o[0], o[0] + d[0]), l.originX, l.cellsX, x0, x1) ||
+		!cellRange(std::min(o[1], o[1] + d[1]), std::max(o[1], o[1] + d[1]), l.originY, l.cellsY, y0, y1)) {
+		return false;
+	}
+
+	// a box spanning several cells is swept once per cell, which can only
+	// repeat the same t, so no dedup is needed here
+	PointSweep best = hit;
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			int c = y * l.cellsX + x;
+			for (uint32_t k = l.cellStart[c]; k < l.cellStart[c + 1]; k += BOX_BATCH) {
+				sweepPoint8(o, d, l.cellBoxes, k, axisMask, best);
+			}
+		}
+	}
+	if (!(best.t < hit.t)) return false;
+	hit.t = best.t;
+	hit.axis = best.axis;
+	hit.index = l.cellItems[best.index];
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BAKED FILE
+// -----------------------------------------------------------------------------
+
+static constexpr char     COLLISION_FILE_MAGIC[4] = { 'T', 'T', 'C', 'W' };
+static constexpr uint32_t COLLISION_FILE_VERSION = 1;
+static constexpr size_t   COLLISION_FILE_ALIGN = 64;
+static constexpr uint32_t COLLISION_FILE_MAX_LAYERS = 16;
+
+struct CollisionFileHeader {
+	char     magic[4];
+	uint32_t version;
+	uint64_t fileSize;
+	uint32_t boxCount;        // level boxes, not padded
+	uint32_t layerCount;
+	float    cellSize;
+	uint32_t reserved;
+	uint64_t boxesOffset;     // BoundingBox[boxCount]
+	uint64_t layersOffset;    // CollisionFileLayer[layerCount]
+};
+
+struct CollisionFileLayer {
+	float    radius;
+	float    originX, originY;
+	int32_t  cellsX, cellsY;
+	uint32_t boxCount;        // padded to BOX_BATCH
+	uint32_t cellEntries;     // padded to BOX_BATCH per cell
+	uint32_t reserved;
+	uint64_t boxesOffset;     // six float arrays of boxCount: minX, minY, minZ, maxX, maxY, maxZ
+	uint64_t cellStartOffset; // uint32_t[cellsX * cellsY + 1]
+	uint64_t cellItemsOffset; // uint32_t[cellEntries]
+	uint64_t cellBoxesOffset; // six float arrays of cellEntries
+};
+
+static_assert(sizeof(BoundingBox) == 24, "baked files store BoundingBox as six floats");
+static_assert(sizeof(CollisionFileHeader) == 48, "header layout is part of the file format");
+static_assert(sizeof(CollisionFileLayer) == 64, "layer layout is part of the file format");
+
+// appends `size` bytes at the next aligned offset and returns that offset
+static uint64_t appendAligned(std::vector<uint8_t>& out, const void* data, size_t size) {
+	out.resize((out.size() + COLLISION_FILE_ALIGN - 1) / COLLISION_FILE_ALIGN * COLLISION_FILE_ALIGN);
+	uint64_t offset = out.size();
+	if (size) {
+		out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+	}
+	return offset;
+}
+
+static uint64_t appendBoxArrays(std::vector<uint8_t>& out, const BoxArrays& b) {
+	size_t bytes = b.size() * sizeof(float);
+	uint64_t offset = appendAligned(out, b.minX, bytes);
+	for (const float* a : { b.minY, b.minZ, b.maxX, b.maxY, b.maxZ }) {
+		out.insert(out.end(), (const uint8_t*)a, (const uint8_t*)a + bytes);
+	}
+	return offset;
+}
+
+bool CollisionWorld::save(const wchar_t* fileAddr) const {
+	std::vector<uint8_t> out;
+	CollisionFileHeader header = {};
+	memcpy(header.magic, COLLISION_FILE_MAGIC, sizeof header.magic);
+	header.version = COLLISION_FILE_VERSION;
+	header.boxCount = (uint32_t)count;
+	header.layerCount = (uint32_t)layers.size();
+	header.cellSize = cellSize;
+	appendAligned(out, &header, sizeof header);
+	header.boxesOffset = appendAligned(out, level, count * sizeof(BoundingBox));
+
+	// the header and layer table are written again once every offset is known
+	std::vector<CollisionFileLayer> table(layers.size());
+	header.layersOffset = appendAligned(out, table.data(), table.size() * sizeof(CollisionFileLayer));
+	for (size_t l = 0; l < layers.size(); l++) {
+		const Layer& layer = layers[l];
+		CollisionFileLayer& t = table[l];
+		t.radius = layer.radius;
+		t.originX = layer.originX;
+		t.originY = layer.originY;
+		t.cellsX = layer.cellsX;
+		t.cellsY = layer.cellsY;
+		t.boxCount = (uint32_t)layer.boxes.size();
+		t.cellEntries = (uint32_t)layer.cellBoxes.size();
+		t.boxesOffset = appendBoxArrays(out, layer.boxes);
+		t.cellStartOffset = appendAligned(out, layer.cellStart, ((size_t)layer.cellsX * layer.cellsY + 1) * sizeof(uint32_t));
+		t.cellItemsOffset = appendAligned(out, layer.cellItems, t.cellEntries * sizeof(uint32_t));
+		t.cellBoxesOffset = appendBoxArrays(out, layer.cellBoxes);
+	}
+	header.fileSize = out.size();
+	memcpy(out.data(), &header, sizeof header);
+	memcpy(out.data() + header.layersOffset, table.data(), table.size() * sizeof(CollisionFileLayer));
+
+	// Another server or a client may have the old file mapped, truncating it
+	// under them would fault their reads. Write a new file and swap it in,
+	// they keep the old contents until they map it again.
+	std::filesystem::path path(fileAddr);
+	std::filesystem::path tempPath = path;
+	tempPath += L".tmp";
+	{
+		std::ofstream outFile(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (outFile) {
+			outFile.write(reinterpret_cast<const char*>(out.data()), out.size());
+			outFile.close();
+		}
+		if (!outFile) {
+			fprintf(stderr, "Cannot write file %ls\n", tempPath.wstring().c_str());
+			std::error_code ignored;
+			std::filesystem::remove(tempPath, ignored);
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+	if (ec) {
+		fprintf(stderr, "Cannot replace file %ls: %s\n", fileAddr, ec.message().c_str());
+		std::filesystem::remove(tempPath, ec);
+		return false;
+	}
+	printf("[COLLISION] baked %zu boxes in %zu layers to %ls (%zu bytes)\n", count, layers.size(), fileAddr, out.size());
+	return true;
+}
+
+// true if [offset, offset + size) lies inside the file
+static bool inFile(const MappedFile& f, uint64_t offset, uint64_t size) {
+	return offset % sizeof(float) == 0 && offset <= f.size() && size <= f.size() - offset;
+}
+
+static BoxArrays mapBoxArrays(const MappedFile& f, uint64_t offset, size_t n) {
+	const float* p = reinterpret_cast<const float*>(f.data() + offset);
+	return { p, p + n, p + 2 * n, p + 3 * n, p + 4 * n, p + 5 * n, n };
+}
+
+bool CollisionWorld::load(const wchar_t* fileAddr) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile f;
+	if (!f.open(fileAddr)) {
+		return false;
+	}
+
+	// Check every count and offset before pointing anything at the mapping,
+	// a truncated or foreign file must not crash the server
+	auto invalid = [&](const char* why) {
+		fprintf(stderr, "Ignoring baked collision file %ls: %s\n", fileAddr, why);
+		return false;
+	};
+	if (f.size() < sizeof(CollisionFileHeader)) return invalid("too short");
+	CollisionFileHeader header;
+	memcpy(&header, f.data(), sizeof header);
+	if (memcmp(header.magic, COLLISION_FILE_MAGIC, sizeof header.magic) != 0) return invalid("not a collision file");
+	if (header.version != COLLISION_FILE_VERSION) return invalid("unsupported version");
+	if (header.fileSize != f.size()) return invalid("truncated");
+	if (!(header.cellSize > 0) || header.layerCount > COLLISION_FILE_MAX_LAYERS) return invalid("bad header");
+	if (!inFile(f, header.boxesOffset, (uint64_t)header.boxCount * sizeof(BoundingBox)) ||
+		!inFile(f, header.layersOffset, (uint64_t)header.layerCount * sizeof(CollisionFileLayer))) {
+		return invalid("bad offsets");
+	}
+
+	std::vector<Layer> mapped(header.layerCount);
+	const CollisionFileLayer* table = reinterpret_cast<const CollisionFileLayer*>(f.data() + header.layersOffset);
+	for (uint32_t l = 0; l < header.layerCount; l++) {
+		const CollisionFileLayer& t = table[l];
+		if (t.cellsX < 0 || t.cellsY < 0 || (uint64_t)t.cellsX * (uint64_t)t.cellsY >= UINT32_MAX ||
+			t.boxCount % BOX_BATCH != 0 || t.boxCount < header.boxCount || t.cellEntries % BOX_BATCH != 0) {
+			return invalid("bad layer");
+		}
+		uint64_t cells = (uint64_t)t.cellsX * (uint64_t)t.cellsY;
+		if (!inFile(f, t.boxesOffset, 6ull * t.boxCount * sizeof(float)) ||
+			!inFile(f, t.cellStartOffset, (cells + 1) * sizeof(uint32_t)) ||
+			!inFile(f, t.cellItemsOffset, (uint64_t)t.cellEntries * sizeof(uint32_t)) ||
+			!inFile(f, t.cellBoxesOffset, 6ull * t.cellEntries * sizeof(float))) {
+			return invalid("bad layer offsets");
+		}
+
+		const uint32_t* cellStart = reinterpret_cast<const uint32_t*>(f.data() + t.cellStartOffset);
+		const uint32_t* cellItems = reinterpret_cast<const uint32_t*>(f.data() + t.cellItemsOffset);
+		if (cellStart[0] != 0 || cellStart[cells] != t.cellEntries) return invalid("bad cell table");
+		for (uint64_t c = 0; c < cells; c++) {
+			if (cellStart[c + 1] < cellStart[c] || cellStart[c + 1] % BOX_BATCH != 0) return invalid("bad cell table");
+		}
+		for (uint32_t k = 0; k < t.cellEntries; k++) {
+			if (cellItems[k] >= header.boxCount && cellItems[k] != UINT32_MAX) return invalid("bad cell ids");
+		}
+
+		Layer& layer = mapped[l];
+		layer.radius = t.radius;
+		layer.originX = t.originX;
+		layer.originY = t.originY;
+		layer.cellsX = t.cellsX;
+		layer.cellsY = t.cellsY;
+		layer.boxes = mapBoxArrays(f, t.boxesOffset, t.boxCount);
+		layer.cellStart = cellStart;
+		layer.cellItems = cellItems;
+		layer.cellBoxes = mapBoxArrays(f, t.cellBoxesOffset, t.cellEntries);
+	}
+
+	file = std::move(f);
+	layers = std::move(mapped);
+	levelStore.clear();
+	level = reinterpret_cast<const BoundingBox*>(file.data() + header.boxesOffset);
+	count = header.boxCount;
+	cellSize = header.cellSize;
+	lastSeen.assign(count, 0);
+	queryStamp = 0;
+
+	auto end = std::chrono::steady_clock::now();
+	printf("[COLLISION] mapped %ls: %zu boxes in %zu layers in %.1f us\n", fileAddr, count, layers.size(),
+		std::chrono::duration<double, std::micro>(end - start).count());
+	return true;
+}
@@ -0,0 +1,123 @@
+#include "MappedFile.h"
+#include <filesystem>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: ptr(std::exchange(other.ptr, nullptr)), len(std::exchange(other.len, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		ptr = std::exchange(other.ptr, nullptr);
+		len = std::exchange(other.len, 0);
+	}
+	return *this;
+}
+
+#if defined(_WIN32)
+
+static HANDLE openForMapping(const wchar_t* fileAddr) {
+	HANDLE file = CreateFileW(fileAddr, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file != INVALID_HANDLE_VALUE) return file;
+
+	// fall back to the folder of the running exe
+	wchar_t moduleName[MAX_PATH] = {};
+	if (!GetModuleFileNameW(nullptr, moduleName, MAX_PATH)) return INVALID_HANDLE_VALUE;
+	std::filesystem::path nextToExe = std::filesystem::path(moduleName).parent_path() / fileAddr;
+	return CreateFileW(nextToExe.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+bool MappedFile::open(const wchar_t* fileAddr) {
+	close();
+	HANDLE file = openForMapping(fileAddr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping) return false;
+
+	// the view keeps the mapping alive once it exists
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) return false;
+
+	ptr = static_cast<const uint8_t*>(view);
+	len = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close() {
+	if (ptr) {
+		UnmapViewOfFile(ptr);
+	}
+	ptr = nullptr;
+	len = 0;
+}
+
+#else
+
+static int openForMapping(const wchar_t* fileAddr) {
+	std::filesystem::path path(fileAddr);
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd >= 0 || path.is_absolute()) return fd;
+
+	// fall back to the folder of the running exe
+	std::error_code ec;
+	std::filesystem::path exe = std::filesystem::read_symlink("/proc/self/exe", ec);
+	if (ec) return -1;
+	std::filesystem::path nextToExe = exe.parent_path() / path;
+	return ::open(nextToExe.c_str(), O_RDONLY);
+}
+
+bool MappedFile::open(const wchar_t* fileAddr) {
+	close();
+	int fd = openForMapping(fileAddr);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED) return false;
+
+	ptr = static_cast<const uint8_t*>(view);
+	len = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::close() {
+	if (ptr) {
+		munmap(const_cast<uint8_t*>(ptr), len);
+	}
+	ptr = nullptr;
+	len = 0;
+}
+
+#endif
@@ -1,7 +1,37 @@
 #include "NetworkServices.h"
 
 int NetworkServices::sendMessage(SOCKET curSocket, char* message, int messageSize) {
+#if defined(_WIN32)
 	return send(curSocket, message, messageSize, 0);
+#else
+	// a client that went away must not kill the server with SIGPIPE
+	return send(curSocket, message, messageSize, MSG_NOSIGNAL);
+#endif
+}
+
+int NetworkServices::sendGather(SOCKET curSocket, const char* const* parts, const int* lengths, int count) {
+#if defined(_WIN32)
+	WSABUF bufs[GATHER_MAX];
+	for (int i = 0; i < count; i++) {
+		bufs[i].buf = (char*)parts[i];
+		bufs[i].len = (u_long)lengths[i];
+	}
+	DWORD sent = 0;
+	if (WSASend(curSocket, bufs, (DWORD)count, &sent, 0, NULL, NULL) == SOCKET_ERROR) {
+		return SOCKET_ERROR;
+	}
+	return (int)sent;
+#else
+	iovec bufs[GATHER_MAX];
+	for (int i = 0; i < count; i++) {
+		bufs[i].iov_base = (void*)parts[i];
+		bufs[i].iov_len = (size_t)lengths[i];
+	}
+	msghdr msg{};
+	msg.msg_iov = bufs;
+	msg.msg_iovlen = count;
+	return (int)sendmsg(curSocket, &msg, MSG_NOSIGNAL);
+#endif
 }
 
 int NetworkServices::recvMessage(SOCKET curSocket, char* buffer, int bufSize) {
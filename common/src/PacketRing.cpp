@@ -0,0 +1,46 @@
+#include "PacketRing.h"
+#include <algorithm>
+#include <cstring>
+
+static constexpr size_t MASK = PacketRing::CAPACITY - 1;
+
+char* PacketRing::writeSpan(size_t& length) {
+	size_t pos = (size_t)(head & MASK);
+	length = std::min(CAPACITY - size(), CAPACITY - pos);
+	return buf.data() + pos;
+}
+
+void PacketRing::commit(size_t length) {
+	head += length;
+}
+
+void PacketRing::copyOut(uint64_t from, char* to, size_t length) const {
+	size_t pos = (size_t)(from & MASK);
+	size_t first = std::min(length, CAPACITY - pos);
+	memcpy(to, buf.data() + pos, first);
+	memcpy(to + first, buf.data(), length - first);
+}
+
+bool PacketRing::next(View& packet) {
+	if (broken || size() < HDR_SIZE) return false;
+
+	PacketHeader hdr;
+	copyOut(tail, (char*)&hdr, sizeof hdr);
+	if (hdr.len < HDR_SIZE || hdr.len > MAX_PACKET_SIZE) {
+		broken = true;
+		return false;
+	}
+	if (size() < hdr.len) return false;
+
+	size_t pos = (size_t)(tail & MASK);
+	if (pos + hdr.len <= CAPACITY) {
+		packet.data = buf.data() + pos;
+	}
+	else {
+		copyOut(tail, scratch, hdr.len);
+		packet.data = scratch;
+	}
+	packet.length = hdr.len;
+	tail += hdr.len;
+	return true;
+}
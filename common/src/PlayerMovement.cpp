@@ -0,0 +1,275 @@
+#include "PlayerMovement.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+// -----------------------------------------------------------------------------
+// LEVEL
+// -----------------------------------------------------------------------------
+
+bool PlayerMovement::loadCollision(const wchar_t* bakedAddr, const wchar_t* jsonAddr) {
+	// the JSON export is the source of truth, a baked file older than it is stale
+	std::error_code ec;
+	auto jsonTime = std::filesystem::last_write_time(jsonAddr, ec);
+	bool jsonFound = !ec;
+	auto bakedTime = std::filesystem::last_write_time(bakedAddr, ec);
+	bool stale = jsonFound && !ec && bakedTime < jsonTime;
+	if (stale) {
+		printf("[COLLISION] %ls is older than %ls, rebaking\n", bakedAddr, jsonAddr);
+	}
+
+	CollisionWorld next;
+	bool mapped = !stale && next.load(bakedAddr);
+	if (mapped && (next.layerFor(PLAYER_RADIUS) < 0 || next.layerFor(BEAR_HITBOX) < 0)) {
+		// baked for other player sizes: regrow the layers from its boxes, still no parse
+		printf("[COLLISION] %ls has no layer for the current player sizes, rebaking\n", bakedAddr);
+		next.build(next.levelBoxes(), { PLAYER_RADIUS, BEAR_HITBOX });
+		mapped = false;
+	}
+	else if (!mapped) {
+		std::vector<BoundingBox> boxes;
+		if (!CollisionWorld::readJson(jsonAddr, boxes)) {
+			return false;
+		}
+		// bucket the boxes once so each tick only tests the ones near a player,
+		// with one copy grown by each player radius so players collide as points
+		next.build(boxes, { PLAYER_RADIUS, BEAR_HITBOX });
+	}
+
+	// the new level is complete, swap it in
+	collision = std::move(next);
+	playerLayer = collision.layerFor(PLAYER_RADIUS);
+	bearLayer = collision.layerFor(BEAR_HITBOX);
+
+	// bake after the swap so no mapping of the old file is left open
+	if (!mapped) {
+		collision.save(bakedAddr);
+	}
+	return true;
+}
+
+int PlayerMovement::bakeCollision(const wchar_t* jsonAddr, const wchar_t* bakedAddr) {
+	std::vector<BoundingBox> boxes;
+	if (!CollisionWorld::readJson(jsonAddr, boxes)) {
+		return 1;
+	}
+	CollisionWorld world;
+	world.build(boxes, { PLAYER_RADIUS, BEAR_HITBOX });
+	return world.save(bakedAddr) ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// STEP
+// -----------------------------------------------------------------------------
+
+PlayerMovement::Modifiers PlayerMovement::modifiersAt(const PlayerState& player, uint64_t tick, float extraJump) {
+	Modifiers modifiers;
+	modifiers.extraJump = extraJump;
+	modifiers.slowed = tick >= player.slowedFrom && tick < player.slowedUntil;
+	modifiers.stunned = tick < player.stunnedUntil;
+	modifiers.dodging = tick < player.dodgingUntil;
+	return modifiers;
+}
+
+PlayerMovement::Result PlayerMovement::step(PlayerState* players, int count, unsigned int id, const MovePayload* input, const Modifiers& modifiers) {
+	PlayerState& player = players[id];
+	Result result;
+
+	float dx = 0, dy = 0, dz = 0;
+	if (input) {
+		// update direction regardless of collision
+		player.yaw = input->yaw;
+		player.pitch = input->pitch;
+
+		// normalize the direction vector
+		float direction[3] = { input->direction[0], input->direction[1], input->direction[2] };
+		float magnitude = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		if (magnitude != 0)
+			for (int i = 0; i < 3; i++)
+				direction[i] /= magnitude;
+
+		// convert intent + yaw into 2d vector
+		// CLOCKWISE positive
+		// foward x/y, actual delta x/y
+		float fx = -sinf(input->yaw), fy = cosf(input->yaw);
+
+		dx = ((fx * direction[0]) + (fy * direction[1])) * player.speed;
+
+		dy = ((fy * direction[0]) - (fx * direction[1])) * player.speed;
+
+		dz = direction[2] * player.speed; // vertical movement, if any
+	}
+
+	if (input && input->jump && player.availableJumps > 0 && player.zVelocity <= 0) {
+		player.zVelocity += JUMP_VELOCITY + modifiers.extraJump;
+		player.availableJumps--;
+		if (player.isBear) {
+			player.zVelocity += BEAR_JUMP_BOOST;
+		}
+		result.jumped = true;
+	}
+
+	// gravity
+	if (player.isHunter && player.isPhantom) {
+		player.zVelocity = dz;
+	}
+	else {
+		player.zVelocity -= GRAVITY;
+		if (player.zVelocity < TERMINAL_VELOCITY)
+			player.zVelocity = TERMINAL_VELOCITY;
+	}
+
+	// apply speed modifiers here:
+	// hunter slow debuff
+	if (player.isHunter && modifiers.slowed) {
+		dx *= HUNTER_SLOW_FACTOR;
+		dy *= HUNTER_SLOW_FACTOR;
+	}
+
+	if (player.isBear)
+	{
+		dx *= BEAR_SPEED_MULTIPLIER;
+		dy *= BEAR_SPEED_MULTIPLIER;
+	}
+
+	float move[3] = { dx, dy, player.zVelocity };
+	moveWithCollision(players, count, id, move, modifiers, result);
+	return result;
+}
+
+// -----------------------------------------------------------------------------
+// COLLISION
+// -----------------------------------------------------------------------------
+
+void PlayerMovement::moveWithCollision(PlayerState* players, int count, unsigned int id, const float move[3], const Modifiers& modifiers, Result& result) {
+	PlayerState& player = players[id];
+
+	// The level is collided against the layer grown by this radius, where the
+	// player is just the point pos
+	float playerRadius = PLAYER_RADIUS;
+	int layer = playerLayer;
+	if (player.isBear) {
+		playerRadius = BEAR_HITBOX;
+		layer = bearLayer;
+	}
+
+	float pos[3] = { player.x, player.y, player.z };
+	float delta[3] = { move[0], move[1], move[2] };
+
+	bool dodging = !player.dodgeCollide && modifiers.dodging;
+
+	// A box the player is already inside (dodging through it, spawning in it)
+	// cannot be swept against. While falling, lift the player onto its top.
+	if (delta[2] < 0) {
+		BoundingBox point = { pos[0], pos[1], pos[2], pos[0], pos[1], pos[2] };
+		candidates.clear();
+		collision.query(layer, point, candidates);
+		bool lifted = false;
+		for (uint32_t b : candidates) {
+			BoundingBox box = collision.box(layer, b);
+			// an earlier lift may already have carried the player out of this box
+			if (pos[2] > box.minZ && pos[2] < box.maxZ) {
+				pos[2] = box.maxZ;
+				lifted = true;
+			}
+		}
+		if (lifted) {
+			delta[2] = 0;
+			player.isGrounded = true;
+			player.availableJumps = player.jumpCounts;
+			player.zVelocity = 0;
+		}
+	}
+
+	// Move to the earliest impact, drop the blocked component and slide along
+	// the surface with what is left. Each pass blocks one axis, so three passes
+	// resolve any move no matter how fast it is.
+	for (int pass = 0; pass < 3; pass++) {
+		if (delta[0] == 0 && delta[1] == 0 && delta[2] == 0) break;
+
+		BoundingBox point = { pos[0], pos[1], pos[2], pos[0], pos[1], pos[2] };
+		float firstHit = 1.0f;
+		int hitAxis = -1;
+		int hitPlayer = -1;
+
+		// other players, their box grown by our radius so we stay a point
+		float reach = playerRadius + playerRadius;
+		for (int c = 0; c < count; c++) {
+			if (c == (int)id) {
+				continue;
+			}
+
+			const PlayerState& other = players[c];
+			BoundingBox otherClientBox = {
+				other.x - reach, other.y - reach, other.z - reach,
+				other.x + reach, other.y + reach, other.z + reach
+			};
+			float t;
+			int axis;
+			if (sweepBox(point, delta, otherClientBox, t, axis) && t < firstHit) {
+				firstHit = t;
+				hitAxis = axis;
+				hitPlayer = c;
+			}
+		}
+
+		// static level boxes; dodging players pass through the sides of boxes
+		PointSweep hit;
+		hit.t = firstHit;
+		if (collision.sweepPoint(layer, pos, delta, dodging ? 0b100u : 0b111u, hit)) {
+			firstHit = hit.t;
+			hitAxis = hit.axis;
+			hitPlayer = -1;
+		}
+
+		// stop just short of the contact so the boxes never end up overlapping
+		float length = sqrtf(delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2]);
+		float travel = (hitAxis < 0) ? 1.0f : std::max(0.0f, firstHit - COLLISION_SKIN / length);
+		for (int i = 0; i < 3; i++) {
+			pos[i] += delta[i] * travel;
+		}
+		if (hitAxis < 0) break;
+
+		bool falling = delta[2] < 0;
+		for (int i = 0; i < 3; i++) {
+			delta[i] *= (1.0f - travel);
+		}
+		delta[hitAxis] = 0;
+
+		if (hitPlayer >= 0) {
+			// If the z is being changed, reset z velocity and "ground" player
+			if (hitAxis == 2) {
+				// Check with zVelocity, not dz
+				if (player.zVelocity < 0) player.isGrounded = true;
+				player.zVelocity = 0;
+			}
+
+			// a bear running into the hunter stuns them and stops being a bear
+			if (player.isBear && players[hitPlayer].isHunter) {
+				player.isBear = false;
+				result.bearImpact = true;
+			}
+		}
+		else if (hitAxis == 2 && falling) {
+			// Landing on top of a box
+			player.isGrounded = true;
+			player.availableJumps = player.jumpCounts;
+			player.zVelocity = 0;
+		}
+	}
+
+	// hunter cannot move if stunned by bear
+	if (!player.isHunter || !modifiers.stunned)
+	{
+		player.x = pos[0];
+		player.y = pos[1];
+		player.z = pos[2];
+	}
+
+	if (player.z < 0) {
+		player.z = 0;
+		player.zVelocity = 0;
+		if (move[2] < 0) player.isGrounded = true;
+	}
+}
@@ -0,0 +1,297 @@
+#include "Snapshot.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+namespace {
+
+static constexpr int CHANGED_BITS = 5;
+static constexpr uint32_t TIMER_CHANGED = 1 << 0;
+static constexpr int PLAYERS_SHIFT = 1;
+
+enum Flag : uint8_t {
+	IS_HUNTER     = 1 << 0,
+	IS_DEAD       = 1 << 1,
+	IS_GROUNDED   = 1 << 2,
+	IS_BEAR       = 1 << 3,
+	IS_PHANTOM    = 1 << 4,
+	DODGE_COLLIDE = 1 << 5,
+};
+
+uint8_t packFlags(const PlayerState& p) {
+	return (p.isHunter ? IS_HUNTER : 0) | (p.isDead ? IS_DEAD : 0) | (p.isGrounded ? IS_GROUNDED : 0) |
+		(p.isBear ? IS_BEAR : 0) | (p.isPhantom ? IS_PHANTOM : 0) | (p.dodgeCollide ? DODGE_COLLIDE : 0);
+}
+
+void unpackFlags(PlayerState& p, uint32_t flags) {
+	p.isHunter = flags & IS_HUNTER;
+	p.isDead = flags & IS_DEAD;
+	p.isGrounded = flags & IS_GROUNDED;
+	p.isBear = flags & IS_BEAR;
+	p.isPhantom = flags & IS_PHANTOM;
+	p.dodgeCollide = flags & DODGE_COLLIDE;
+}
+
+// -----------------------------------------------------------------------------
+// QUANTIZATION
+// -----------------------------------------------------------------------------
+
+// Every quantize() result dequantizes to a value that quantizes back to it,
+// so the client's copy of a baseline compares the same as the server's
+
+uint32_t quantize(float value, float lo, float hi, int bits) {
+	uint32_t steps = (1u << bits) - 1;
+	float t = (std::clamp(value, lo, hi) - lo) / (hi - lo);
+	return (uint32_t)(t * steps + 0.5f);
+}
+
+float dequantize(uint32_t q, float lo, float hi, int bits) {
+	uint32_t steps = (1u << bits) - 1;
+	return lo + (hi - lo) * ((float)q / steps);
+}
+
+static constexpr float TURN = 2.0f * std::numbers::pi_v<float>;
+
+uint32_t quantizeYaw(float yaw) {
+	float turns = yaw / TURN;
+	turns -= std::floor(turns);
+	return (uint32_t)(turns * (1u << Snapshot::YAW_BITS) + 0.5f) & ((1u << Snapshot::YAW_BITS) - 1);
+}
+
+float dequantizeYaw(uint32_t q) {
+	return TURN * ((float)q / (1u << Snapshot::YAW_BITS));
+}
+
+static constexpr float HALF_TURN = std::numbers::pi_v<float> / 2;
+
+uint32_t bitsOf(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	return bits;
+}
+
+float floatOf(uint32_t bits) {
+	float value;
+	memcpy(&value, &bits, sizeof value);
+	return value;
+}
+
+// a player's fields as they go on the wire, in Field order
+struct WirePlayer {
+	uint32_t field[Snapshot::FIELD_COUNT];
+};
+
+WirePlayer toWire(const PlayerState& p) {
+	using namespace Snapshot;
+	return { {
+		quantize(p.x, WORLD_MIN[0], WORLD_MAX[0], POSITION_BITS),
+		quantize(p.y, WORLD_MIN[1], WORLD_MAX[1], POSITION_BITS),
+		quantize(p.z, WORLD_MIN[2], WORLD_MAX[2], POSITION_BITS),
+		quantizeYaw(p.yaw),
+		quantize(p.pitch, -HALF_TURN, HALF_TURN, PITCH_BITS),
+		bitsOf(p.zVelocity),
+		bitsOf(p.speed),
+		p.coins,
+		packFlags(p),
+		(uint32_t)std::clamp(p.jumpCounts, 0, 255),
+		(uint32_t)std::clamp(p.availableJumps, 0, 255),
+		p.slowedFrom,
+		p.slowedUntil,
+		p.stunnedUntil,
+		p.dodgingUntil,
+	} };
+}
+
+void fromWire(PlayerState& p, const WirePlayer& w, uint16_t fields) {
+	using namespace Snapshot;
+	if (fields & X) p.x = dequantize(w.field[0], WORLD_MIN[0], WORLD_MAX[0], POSITION_BITS);
+	if (fields & Y) p.y = dequantize(w.field[1], WORLD_MIN[1], WORLD_MAX[1], POSITION_BITS);
+	if (fields & Z) p.z = dequantize(w.field[2], WORLD_MIN[2], WORLD_MAX[2], POSITION_BITS);
+	if (fields & YAW) p.yaw = dequantizeYaw(w.field[3]);
+	if (fields & PITCH) p.pitch = dequantize(w.field[4], -HALF_TURN, HALF_TURN, PITCH_BITS);
+	if (fields & Z_VELOCITY) p.zVelocity = floatOf(w.field[5]);
+	if (fields & SPEED) p.speed = floatOf(w.field[6]);
+	if (fields & COINS) p.coins = (uint8_t)w.field[7];
+	if (fields & FLAGS) unpackFlags(p, w.field[8]);
+	if (fields & JUMP_COUNTS) p.jumpCounts = (int)w.field[9];
+	if (fields & AVAILABLE_JUMPS) p.availableJumps = (int)w.field[10];
+	if (fields & SLOWED_FROM) p.slowedFrom = w.field[11];
+	if (fields & SLOWED_UNTIL) p.slowedUntil = w.field[12];
+	if (fields & STUNNED_UNTIL) p.stunnedUntil = w.field[13];
+	if (fields & DODGING_UNTIL) p.dodgingUntil = w.field[14];
+}
+
+uint32_t quantizeTimer(float timerFrac) {
+	return quantize(timerFrac, 0.0f, 1.0f, Snapshot::TIMER_BITS);
+}
+
+// -----------------------------------------------------------------------------
+// BIT STREAMS
+// -----------------------------------------------------------------------------
+
+// Bits go out least significant first, filling each byte from its low bit
+struct BitWriter {
+	uint8_t* out;
+	size_t bytes = 0;
+	uint64_t pending = 0;
+	int pendingBits = 0;
+
+	void put(uint32_t value, int bits) {
+		pending |= (uint64_t)(value & (uint32_t)((1ull << bits) - 1)) << pendingBits;
+		pendingBits += bits;
+		while (pendingBits >= 8) {
+			out[bytes++] = (uint8_t)pending;
+			pending >>= 8;
+			pendingBits -= 8;
+		}
+	}
+
+	void varint(uint64_t value) {
+		while (value >= 0x80) {
+			put((uint32_t)(value & 0x7f) | 0x80, 8);
+			value >>= 7;
+		}
+		put((uint32_t)value, 8);
+	}
+
+	size_t finish() {
+		if (pendingBits > 0) put(0, 8 - pendingBits);
+		return bytes;
+	}
+};
+
+struct BitReader {
+	const uint8_t* data;
+	size_t length;
+	size_t bytes = 0;
+	uint64_t pending = 0;
+	int pendingBits = 0;
+
+	bool get(uint32_t& value, int bits) {
+		while (pendingBits < bits) {
+			if (bytes >= length) return false;
+			pending |= (uint64_t)data[bytes++] << pendingBits;
+			pendingBits += 8;
+		}
+		value = (uint32_t)(pending & ((1ull << bits) - 1));
+		pending >>= bits;
+		pendingBits -= bits;
+		return true;
+	}
+
+	bool varint(uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			uint32_t b;
+			if (!get(b, 8)) return false;
+			value |= (uint64_t)(b & 0x7f) << shift;
+			if (!(b & 0x80)) return true;
+		}
+		return false;
+	}
+
+	// whatever is left must be the zero padding of the last byte
+	bool atEnd() const {
+		return bytes == length && pendingBits < 8 && pending == 0;
+	}
+};
+
+const GameState ZERO_STATE{};
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+// ENCODING
+// -----------------------------------------------------------------------------
+
+size_t Snapshot::encode(const GameState& state, uint32_t sequence, const GameState* base, uint32_t baseSequence,
+	uint32_t inputSequence, uint8_t* out) {
+	if (!base) {
+		base = &ZERO_STATE;
+		baseSequence = sequence;
+	}
+
+	BitWriter w{ out };
+	w.varint(sequence);
+	w.varint(sequence - baseSequence);
+	w.varint(state.tick - base->tick);
+	w.varint(inputSequence);
+
+	WirePlayer players[4];
+	uint16_t fields[4];
+	uint32_t timer = quantizeTimer(state.timerFrac);
+	uint32_t changed = timer != quantizeTimer(base->timerFrac) ? TIMER_CHANGED : 0;
+	for (int i = 0; i < 4; i++) {
+		players[i] = toWire(state.players[i]);
+		WirePlayer was = toWire(base->players[i]);
+		fields[i] = 0;
+		for (int f = 0; f < FIELD_COUNT; f++) {
+			if (players[i].field[f] != was.field[f]) fields[i] |= 1 << f;
+		}
+		if (fields[i]) changed |= 1 << (PLAYERS_SHIFT + i);
+	}
+	w.put(changed, CHANGED_BITS);
+	if (changed & TIMER_CHANGED) w.put(timer, TIMER_BITS);
+
+	for (int i = 0; i < 4; i++) {
+		if (!fields[i]) continue;
+		w.put(fields[i], FIELD_COUNT);
+		for (int f = 0; f < FIELD_COUNT; f++) {
+			if (fields[i] & (1 << f)) w.put(players[i].field[f], FIELD_BITS[f]);
+		}
+	}
+	return w.finish();
+}
+
+// -----------------------------------------------------------------------------
+// HISTORY
+// -----------------------------------------------------------------------------
+
+void SnapshotHistory::push(uint32_t sequence, const GameState& state) {
+	Entry& entry = entries[sequence % Snapshot::HISTORY];
+	entry.sequence = sequence;
+	entry.state = state;
+}
+
+const GameState* SnapshotHistory::find(uint32_t sequence) const {
+	const Entry& entry = entries[sequence % Snapshot::HISTORY];
+	return sequence != 0 && entry.sequence == sequence ? &entry.state : nullptr;
+}
+
+bool SnapshotHistory::decode(const uint8_t* data, size_t length, GameState& state, uint32_t& sequence, uint32_t& inputSequence) const {
+	using namespace Snapshot;
+	BitReader r{ data, length };
+	uint64_t seq, baseOffset, tickOffset, input;
+	if (!r.varint(seq) || !r.varint(baseOffset) || !r.varint(tickOffset) || !r.varint(input)) return false;
+
+	const GameState* base = &ZERO_STATE;
+	if (baseOffset != 0) {
+		base = find((uint32_t)(seq - baseOffset));
+		if (!base) return false;
+	}
+	state = *base;
+	state.tick = base->tick + tickOffset;
+
+	uint32_t changed, timer;
+	if (!r.get(changed, CHANGED_BITS)) return false;
+	if (changed & TIMER_CHANGED) {
+		if (!r.get(timer, TIMER_BITS)) return false;
+		state.timerFrac = dequantize(timer, 0.0f, 1.0f, TIMER_BITS);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		if (!(changed & (1 << (PLAYERS_SHIFT + i)))) continue;
+		uint32_t fields;
+		if (!r.get(fields, FIELD_COUNT)) return false;
+		WirePlayer w{};
+		for (int f = 0; f < FIELD_COUNT; f++) {
+			if ((fields & (1 << f)) && !r.get(w.field[f], FIELD_BITS[f])) return false;
+		}
+		fromWire(state.players[i], w, (uint16_t)fields);
+	}
+
+	sequence = (uint32_t)seq;
+	inputSequence = (uint32_t)input;
+	return r.atEnd();
+}
@@ -0,0 +1,301 @@
+#include "UdpTransport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <ws2tcpip.h>
+#endif
+
+static constexpr uint8_t MAGIC[2] = { 'T', 'T' };
+static constexpr size_t HEADER_SIZE = 11;
+
+Channel channelOf(PacketType type) {
+	switch (type) {
+	case PacketType::GAME_STATE:
+	case PacketType::SNAPSHOT:
+	case PacketType::SNAPSHOT_ACK:
+	case PacketType::ANIMATION_STATE:
+	case PacketType::MOVE:
+	case PacketType::CAMERA:
+		return Channel::UNRELIABLE;
+	default:
+		return Channel::RELIABLE;
+	}
+}
+
+uint64_t udpNowMs() {
+	using namespace std::chrono;
+	return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// true when sequence `a` comes after `b`, across wrap-around
+static bool newer(uint16_t a, uint16_t b) {
+	return (int16_t)(a - b) > 0;
+}
+
+// -----------------------------------------------------------------------------
+// SOCKET
+// -----------------------------------------------------------------------------
+
+UdpSocket::~UdpSocket() {
+	if (sock != INVALID_SOCKET) {
+		closesocket(sock);
+	}
+}
+
+bool UdpSocket::open(uint16_t port) {
+	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock == INVALID_SOCKET) {
+		printf("[UDP] socket failed with error: %d\n", WSAGetLastError());
+		return false;
+	}
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	u_long iMode = 1;
+	if (bind(sock, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR || ioctlsocket(sock, FIONBIO, &iMode) == SOCKET_ERROR) {
+		printf("[UDP] could not bind port %u: %d\n", port, WSAGetLastError());
+		closesocket(sock);
+		sock = INVALID_SOCKET;
+		return false;
+	}
+	return true;
+}
+
+uint16_t UdpSocket::port() const {
+	sockaddr_in addr;
+	socklen_t length = sizeof(addr);
+	if (getsockname(sock, (sockaddr*)&addr, &length) == SOCKET_ERROR) return 0;
+	return ntohs(addr.sin_port);
+}
+
+void UdpSocket::simulate(const LossSimulator& settings, uint32_t seed) {
+	loss = settings;
+	simulating = loss.lossPercent > 0 || loss.latencyMs > 0 || loss.jitterMs > 0;
+	gen.seed(seed);
+}
+
+void UdpSocket::transmit(const sockaddr_in& to, const uint8_t* data, size_t length) {
+	calls++;
+	sendto(sock, (const char*)data, (int)length, 0, (const sockaddr*)&to, sizeof(to));
+}
+
+void UdpSocket::sendTo(const sockaddr_in& to, const uint8_t* data, size_t length) {
+	if (sock == INVALID_SOCKET) return;
+	if (!simulating) {
+		transmit(to, data, length);
+		return;
+	}
+
+	if (std::uniform_real_distribution<float>(0.0f, 100.0f)(gen) < loss.lossPercent) return;
+	uint32_t jitter = loss.jitterMs ? std::uniform_int_distribution<uint32_t>(0, loss.jitterMs)(gen) : 0;
+	delayed.push_back({ udpNowMs() + loss.latencyMs + jitter, to, std::vector<uint8_t>(data, data + length) });
+}
+
+void UdpSocket::flush(uint64_t nowMs) {
+	for (size_t i = 0; i < delayed.size();) {
+		if (delayed[i].dueMs > nowMs) {
+			i++;
+			continue;
+		}
+		transmit(delayed[i].to, delayed[i].data.data(), delayed[i].data.size());
+		delayed[i] = std::move(delayed.back());
+		delayed.pop_back();
+	}
+}
+
+bool UdpSocket::receive(sockaddr_in& from, std::vector<uint8_t>& datagram) {
+	if (sock == INVALID_SOCKET) return false;
+	datagram.resize(UdpConnection::MAX_DATAGRAM);
+	socklen_t fromLength = sizeof(from);
+	int r = recvfrom(sock, (char*)datagram.data(), (int)datagram.size(), 0, (sockaddr*)&from, &fromLength);
+	// would block, or an ICMP error from a peer that went away
+	if (r < 0) return false;
+	datagram.resize(r);
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// CONNECTION
+// -----------------------------------------------------------------------------
+
+UdpConnection::UdpConnection(uint64_t nowMs) : lastReceiveMs(nowMs) {}
+
+void UdpConnection::send(const char* data, int length, uint64_t nowMs) {
+	int i = 0;
+	while (i + (int)HDR_SIZE <= length) {
+		PacketHeader hdr;
+		memcpy(&hdr, data + i, sizeof hdr);
+		if (hdr.len < HDR_SIZE || hdr.len > (uint32_t)(length - i)) break;
+
+		if (channelOf(hdr.type) == Channel::RELIABLE) {
+			uint16_t id = nextMessageId++;
+			pending[id] = { std::vector<char>(data + i, data + i + hdr.len), nowMs };
+			transmit((uint8_t)Channel::RELIABLE, id, data + i, hdr.len, nowMs);
+		}
+		else {
+			transmit((uint8_t)Channel::UNRELIABLE, 0, data + i, hdr.len, nowMs);
+		}
+		i += hdr.len;
+	}
+}
+
+void UdpConnection::transmit(uint8_t channel, uint16_t messageId, const char* packet, uint32_t length, uint64_t nowMs) {
+	uint16_t sequence = localSequence++;
+	Sent& record = sent[sequence % SENT_WINDOW];
+	record = { true, false, channel == (uint8_t)Channel::RELIABLE, sequence, messageId, nowMs };
+
+	std::vector<uint8_t> datagram(HEADER_SIZE + (record.reliable ? 2 : 0) + length);
+	uint8_t flags = channel | (haveRemote ? HAS_ACK : 0);
+	memcpy(&datagram[0], MAGIC, 2);
+	memcpy(&datagram[2], &sequence, 2);
+	memcpy(&datagram[4], &remoteSequence, 2);
+	memcpy(&datagram[6], &remoteBits, 4);
+	datagram[10] = flags;
+	size_t pos = HEADER_SIZE;
+	if (record.reliable) {
+		memcpy(&datagram[pos], &messageId, 2);
+		pos += 2;
+	}
+	if (length) memcpy(&datagram[pos], packet, length);
+
+	outgoing.push_back(std::move(datagram));
+	counters.datagramsSent++;
+	ackOwed = false;
+}
+
+void UdpConnection::acked(uint16_t sequence, uint64_t nowMs) {
+	Sent& record = sent[sequence % SENT_WINDOW];
+	if (!record.used || record.acked || record.sequence != sequence) return;
+	record.acked = true;
+	counters.rttMs += 0.125f * ((float)(nowMs - record.sentMs) - counters.rttMs);
+	if (record.reliable) {
+		pending.erase(record.messageId);
+	}
+}
+
+bool UdpConnection::receive(const uint8_t* datagram, size_t length, uint64_t nowMs, std::vector<char>& delivered) {
+	if (length < HEADER_SIZE || memcmp(datagram, MAGIC, 2) != 0) return false;
+	uint16_t sequence, ack;
+	uint32_t ackBits;
+	memcpy(&sequence, &datagram[2], 2);
+	memcpy(&ack, &datagram[4], 2);
+	memcpy(&ackBits, &datagram[6], 4);
+	uint8_t flags = datagram[10];
+	uint8_t channel = flags & ~HAS_ACK;
+	size_t pos = HEADER_SIZE;
+	uint16_t messageId = 0;
+	if (channel == (uint8_t)Channel::RELIABLE) {
+		if (length < pos + 2) return false;
+		memcpy(&messageId, &datagram[pos], 2);
+		pos += 2;
+	}
+	if (channel != ACK_ONLY) {
+		PacketHeader hdr;
+		if (length < pos + HDR_SIZE) return false;
+		memcpy(&hdr, &datagram[pos], sizeof hdr);
+		if (hdr.len != length - pos) return false;
+	}
+	lastReceiveMs = nowMs;
+	counters.datagramsReceived++;
+
+	if (flags & HAS_ACK) {
+		acked(ack, nowMs);
+		for (int i = 0; i < 32; i++) {
+			if (ackBits & (1u << i)) acked((uint16_t)(ack - 1 - i), nowMs);
+		}
+	}
+
+	// remember the sequence for our acks; bit i of remoteBits is remoteSequence - 1 - i
+	uint64_t extended;
+	if (!haveRemote) {
+		haveRemote = true;
+		remoteSequence = sequence;
+		remoteBits = 0;
+		// one wrap in, so a datagram from before the first one cannot go below 0
+		remoteExtended = 0x10000 | sequence;
+		extended = remoteExtended;
+	}
+	else if (newer(sequence, remoteSequence)) {
+		uint16_t shift = sequence - remoteSequence;
+		remoteBits = shift > 32 ? 0 : ((shift == 32 ? 0 : remoteBits << shift) | (1u << (shift - 1)));
+		remoteSequence = sequence;
+		remoteExtended += shift;
+		extended = remoteExtended;
+	}
+	else {
+		uint16_t behind = remoteSequence - sequence;
+		if (behind == 0 || (behind <= 32 && (remoteBits & (1u << (behind - 1))))) {
+			counters.duplicates++;
+			return true;
+		}
+		if (behind <= 32) remoteBits |= 1u << (behind - 1);
+		extended = remoteExtended - behind;
+	}
+
+	if (channel == ACK_ONLY) return true;
+	ackOwed = true;
+
+	const char* packet = (const char*)datagram + pos;
+	uint32_t packetLength = (uint32_t)(length - pos);
+	if (channel == (uint8_t)Channel::RELIABLE) {
+		deliverReliable(messageId, packet, packetLength, delivered);
+		return true;
+	}
+
+	PacketHeader hdr;
+	memcpy(&hdr, packet, sizeof hdr);
+	if (hdr.type == PacketType::MOVE) {
+		// MOVE carries its own sequence, the input queue puts a swapped pair
+		// back in order and drops late and duplicate ones itself
+		delivered.insert(delivered.end(), packet, packet + packetLength);
+		return true;
+	}
+	auto newest = newestUnreliable.find((uint32_t)hdr.type);
+	if (newest != newestUnreliable.end() && extended <= newest->second) {
+		counters.stale++;
+		return true;
+	}
+	newestUnreliable[(uint32_t)hdr.type] = extended;
+	delivered.insert(delivered.end(), packet, packet + packetLength);
+	return true;
+}
+
+void UdpConnection::deliverReliable(uint16_t messageId, const char* packet, uint32_t length, std::vector<char>& delivered) {
+	uint16_t ahead = messageId - nextDeliverId;
+	if (ahead >= RECEIVE_WINDOW) {
+		// already delivered, its ack got lost
+		counters.duplicates++;
+		return;
+	}
+	if (ahead > 0) {
+		early.emplace(messageId, std::vector<char>(packet, packet + length));
+		return;
+	}
+
+	delivered.insert(delivered.end(), packet, packet + length);
+	nextDeliverId++;
+	for (auto next = early.find(nextDeliverId); next != early.end(); next = early.find(nextDeliverId)) {
+		delivered.insert(delivered.end(), next->second.begin(), next->second.end());
+		early.erase(next);
+		nextDeliverId++;
+	}
+}
+
+void UdpConnection::update(uint64_t nowMs) {
+	uint64_t resendMs = std::clamp((uint32_t)(2.0f * counters.rttMs), RESEND_MIN_MS, RESEND_MAX_MS);
+	for (auto& [id, message] : pending) {
+		if (nowMs - message.lastSentMs < resendMs) continue;
+		message.lastSentMs = nowMs;
+		counters.resent++;
+		transmit((uint8_t)Channel::RELIABLE, id, message.packet.data(), (uint32_t)message.packet.size(), nowMs);
+	}
+	if (ackOwed) {
+		transmit(ACK_ONLY, 0, nullptr, 0, nowMs);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "NetworkData.h"
+#include <cstddef>
+#include <cstdint>
+
+// The hunter's swing tested against every candidate victim at once.
+//
+// A victim is hit inside the small sphere around the hunter whatever the
+// direction, or else within range and ATTACK_ANGLE_DEG of the swing's level
+// direction. Everything compares squared lengths, so there is no square
+// root, and the cone's cosine is worked out at compile time. Targets are kept
+// as arrays so the SSE kernel tests four of them per instruction; the scalar
+// kernel is the reference it has to match bit for bit.
+
+// cos(x) by its Taylor series, for constants; accurate to a float for |x| <= pi
+constexpr double constexprCos(double x) {
+	double term = 1.0, sum = 1.0;
+	for (int n = 1; n < 16; n++) {
+		term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+		sum += term;
+	}
+	return sum;
+}
+
+// hit whatever the direction this close
+static constexpr float SWING_SPHERE_RADIUS = 3e-1f;
+static constexpr float SWING_COS = (float)constexprCos(ATTACK_ANGLE_DEG * 3.14159265358979323846 / 180.0);
+static_assert(ATTACK_ANGLE_DEG < 90.0f, "the squared cone test needs a positive cosine");
+
+struct Swing {
+	float originX, originY, originZ;
+	float forwardX, forwardY;   // unit length, swings are level
+	float rangeSquared;
+
+	// `attack` from its origin along its yaw, reaching `range`
+	static Swing from(const AttackPayload& attack, float range);
+};
+
+// Victims of one swing, refilled each swing without allocating
+struct SwingTargets {
+	static constexpr size_t MAX = 64;   // bits of the hit mask
+	float x[MAX] = {}, y[MAX] = {}, z[MAX] = {};
+	size_t count = 0;
+
+	void clear() { count = 0; }
+	// false when there is no room left
+	bool push(float px, float py, float pz);
+};
+
+// Number of targets tested by one call of the batch kernels
+static constexpr size_t SWING_BATCH = 4;
+
+// Tests targets [first, first + SWING_BATCH) and returns a hit mask, bit k set
+// when target first + k is hit. Targets past the count are garbage, mask them.
+uint32_t swingMask4Scalar(const Swing& swing, const SwingTargets& targets, size_t first);
+uint32_t swingMask4Sse(const Swing& swing, const SwingTargets& targets, size_t first);
+// every target, bit i set when target i is hit
+uint64_t swingHitMask(const Swing& swing, const SwingTargets& targets);
@@ -0,0 +1,16 @@
+#pragma once
+
+// Offline benchmarks, run with `GameServer.exe --bench-<name>` instead of hosting a game.
+// Each returns the process exit code.
+
+// scalar vs SSE vs AVX2 box overlap kernels and the grid broad-phase on bb#_bboxes.json
+int benchCollision();
+
+// quantized keyframe and delta snapshot sizes and encode/decode times against the raw GameState
+int benchSnapshot();
+
+// batched cone/sphere swing test, scalar vs SSE, against one victim at a time with square roots
+int benchSwing();
+
+// reliable and unreliable UDP channels between two loopback sockets with simulated loss and latency
+int benchUdp(float lossPercent);
@@ -0,0 +1,49 @@
+#pragma once
+#include "NetworkServices.h"
+#include <cstddef>
+#include <vector>
+#if !defined(_WIN32)
+#include <sys/epoll.h>
+#endif
+
+// Readiness of every socket the server owns from one wait call: epoll on
+// Linux, a single WSAPoll over all registered sockets on Windows.
+//
+// Level triggered: a socket that was not read dry, or that still has output
+// waiting and asked for write events, shows up again on the next wait. The
+// sockets themselves stay non-blocking, so servicing an event never stalls
+// the tick and one process can host as many connections as it likes.
+class EventLoop {
+public:
+	struct Event {
+		SOCKET sock;
+		bool readable;    // data, a pending accept, or the peer hung up
+		bool writable;
+		bool failed;      // error or hang-up, a read tells which
+	};
+
+	EventLoop();
+	~EventLoop();
+	EventLoop(const EventLoop&) = delete;
+	EventLoop& operator=(const EventLoop&) = delete;
+
+	// watches `sock` for reads, call remove() before closing it
+	void add(SOCKET sock);
+	// write events too, while the socket has output the kernel did not take
+	void watchWrite(SOCKET sock, bool on);
+	void remove(SOCKET sock);
+	size_t size() const { return count; }
+
+	// Waits up to `timeoutMs` (0 only checks) for any socket to be ready.
+	// Fills `events`, replacing what was there, and returns how many.
+	int wait(int timeoutMs, std::vector<Event>& events);
+
+private:
+	size_t count = 0;
+#if defined(_WIN32)
+	std::vector<WSAPOLLFD> fds;
+#else
+	int epollFd = -1;
+	std::vector<epoll_event> ready;
+#endif
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+// Runs the game with no sockets and no sleeping, run with
+// `GameServer --headless [ticks] [seed] [--record log]`. Four scripted bots join a headless
+// ServerGame and play matches back to back: the hunter chases and swings at
+// the nearest runner, runners wander, flee, jump and dodge, and everyone buys
+// what they can afford in the shop. Their numbered MOVEs go through a made up
+// network that delays, swaps, loses and duplicates some, so the input queues
+// are played as a hosted server's. Ticks run as fast as the CPU allows, so
+// this is the throughput benchmark for physics and game logic changes.
+// Reports simulated ticks/s and matches/s and returns the process exit code.
+// `recordAddr`, if set, gets an input log of the run like a hosted server.
+int runHeadless(uint64_t ticks, uint32_t seed, const wchar_t* recordAddr = nullptr);
+
+// Replays an input log written with `GameServer --record <log>`, run with
+// `GameServer --replay <log> [states]`. Every logged packet is queued for
+// the tick it was applied on and the ticks in between run back to back. The
+// states are checked against the hashes in the log and, given a `states`
+// file, written to it tick by tick in the packed InputLog::appendState
+// layout, so two runs can be compared byte for byte. Returns 1 when the
+// replay does not match the recording.
+int runReplay(const wchar_t* logAddr, const wchar_t* statesAddr);
@@ -0,0 +1,95 @@
+#pragma once
+#include "NetworkData.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Binary log of every packet a server applied, with the tick it was applied
+// on and the seed of the game RNG, so a session can be replayed headless and
+// end up in exactly the same states (see runReplay).
+//
+//   header | record | record | ...
+//
+// Each record is a kind byte, then the ticks since the previous record as a
+// varint, then:
+//   PACKET      client id byte, varint length, the packet bytes
+//   REPEAT      client id byte, varint packet type: the same bytes as the
+//               last packet of that type from that client (held keys)
+//   CHECKPOINT  8 byte hash of every GameState up to and including this tick
+// Values are little endian. A log cut short by a crash reads up to the last
+// whole record.
+namespace InputLog {
+	enum class Kind : uint8_t {
+		PACKET = 1,
+		REPEAT = 2,
+		CHECKPOINT = 3,
+	};
+
+	struct Record {
+		Kind kind = Kind::PACKET;
+		uint64_t tick = 0;
+		uint8_t client = 0;
+		const char* data = nullptr;   // PACKET and REPEAT, points into the log
+		uint32_t length = 0;
+		uint64_t hash = 0;            // CHECKPOINT
+	};
+
+	// FNV-1a over the fields of `state`, chained from `hash`. Padding is
+	// skipped, so equal states always hash equal.
+	static constexpr uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+	uint64_t hashState(uint64_t hash, const GameState& state);
+	// the same fields as hashState, packed with no padding
+	void appendState(std::vector<uint8_t>& out, const GameState& state);
+}
+
+class InputRecorder {
+public:
+	// write a checkpoint every this many ticks
+	static constexpr uint64_t CHECKPOINT_TICKS = 64;
+
+	~InputRecorder();
+
+	bool open(const wchar_t* fileAddr, uint64_t seed);
+	void packet(uint64_t tick, unsigned int client, const char* data, uint32_t length);
+	// Folds the state at the end of a tick into the running hash, writing a
+	// checkpoint every CHECKPOINT_TICKS
+	void endTick(const GameState& state);
+	void flush();
+
+	uint64_t packets() const { return packetCount; }
+	uint64_t bytes() const { return written + buffer.size(); }
+
+private:
+	void begin(InputLog::Kind kind, uint64_t tick);
+	void varint(uint64_t value);
+
+	std::ofstream outFile;
+	std::vector<uint8_t> buffer;
+	uint64_t written = 0;
+	uint64_t lastTick = 0;
+	uint64_t hash = InputLog::HASH_SEED;
+	uint64_t packetCount = 0;
+	// last packet of each (client, type), for REPEAT records
+	std::map<std::pair<uint8_t, uint32_t>, std::vector<char>> last;
+};
+
+class InputLogReader {
+public:
+	bool open(const wchar_t* fileAddr);
+	uint64_t seed() const { return rngSeed; }
+	// reads the next record, false at the end of the log; a REPEAT comes back
+	// as the PACKET it repeats
+	bool next(InputLog::Record& record);
+
+private:
+	bool varint(uint64_t& value);
+
+	MappedFile file;
+	size_t pos = 0;
+	uint64_t rngSeed = 0;
+	uint64_t lastTick = 0;
+	std::map<std::pair<uint8_t, uint32_t>, std::pair<const char*, uint32_t>> last;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include "NetworkData.h"
+#include <cstddef>
+#include <cstdint>
+
+// One client's MOVE commands, applied one a tick in sequence order.
+//
+// Clients send a command every tick, but they arrive in bursts, so the queue
+// holds a couple back (the jitter buffer) before it starts applying them and
+// refills to that depth whenever it runs dry. Each tick takes exactly one
+// command: a burst is played out over as many ticks as it has commands
+// instead of collapsing into its newest one.
+//
+// Starved, the last command goes on standing in, without its jump, for up to
+// MAX_REPEATS ticks, then the player stops. Overflowing, the oldest commands
+// are dropped down to TARGET_DEPTH, keeping any jump among them, so a client
+// whose clock runs fast cannot build up latency.
+//
+// Commands without a sequence (recordings from before it) keep the old rule:
+// the newest one received is applied on the next tick, once.
+class InputQueue {
+public:
+	static constexpr size_t CAPACITY = 16;
+	static constexpr size_t TARGET_DEPTH = 2;
+	static constexpr size_t MAX_DEPTH = 6;
+	static constexpr uint32_t MAX_REPEATS = 4;
+
+	struct Stats {
+		uint64_t received = 0;
+		uint64_t applied = 0;
+		uint64_t duplicates = 0;   // received twice
+		uint64_t late = 0;         // arrived after a newer one was applied
+		uint64_t dropped = 0;      // to bring the queue back down
+		uint64_t repeated = 0;     // ticks the last command stood in for a missing one
+		uint64_t starved = 0;      // ticks without a new command
+
+		void add(const Stats& other);
+	};
+
+	void push(const MovePayload& command);
+	// counts `sequence` as applied without applying it, for input the game ignores
+	void skip(uint32_t sequence);
+	// the command for this tick, null when there is none; valid until the next call.
+	// A tick without one only counts as starved when the client was `expected`
+	// to send: connected, spawned and alive
+	const MovePayload* next(bool expected);
+	// forgets the queued commands, when the players are put back at their spawns
+	void clear();
+
+	// sequence of the newest command applied or skipped, echoed to the client
+	uint32_t acked() const { return lastSequence; }
+	size_t depth() const { return count; }
+	const Stats& stats() const { return counters; }
+	void resetStats() { counters = {}; }
+
+private:
+	// removes the `n` oldest commands, moving a jump among them onto the next
+	void drop(size_t n);
+
+	MovePayload queued[CAPACITY];   // oldest first
+	size_t count = 0;
+	bool buffering = true;          // holding back until TARGET_DEPTH are queued
+	MovePayload current{};          // what next() returned
+	bool repeatable = false;        // current may stand in for a missing command
+	uint32_t repeats = 0;
+	uint32_t lastSequence = 0;
+	Stats counters;
+};
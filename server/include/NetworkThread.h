@@ -0,0 +1,104 @@
+#pragma once
+#include "ServerNetwork.h"
+#include "SpscQueue.h"
+#include "TickProfiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Runs ServerNetwork on a thread of its own, so a slow socket never holds up
+// the simulation. The two threads only share two SpscQueues of batches:
+// what one network pass read (connections, whole packets, disconnects) goes
+// to the simulation, and everything the simulation sent during a tick comes
+// back as one batch, written out with one ServerNetwork::flush.
+//
+// Each side times how long the batches it pops sat in the queue and how deep
+// the queue got, and prints that with its other stats.
+class NetworkThread {
+public:
+	enum class EventKind : uint8_t {
+		CONNECTED,
+		PACKET,
+		DISCONNECTED,
+	};
+	struct Event {
+		EventKind kind;
+		unsigned int id;
+		char* data;          // PACKET: one whole packet, valid until the next nextEvent()
+		uint32_t length;
+	};
+
+	// takes over `network`, which the simulation must not touch any more
+	explicit NetworkThread(ServerNetwork* network);
+	~NetworkThread();
+	NetworkThread(const NetworkThread&) = delete;
+	NetworkThread& operator=(const NetworkThread&) = delete;
+
+	// Only before start(), while nothing else uses the network
+	void simulateLoss(const LossSimulator& loss);
+	void start();
+	bool started() const { return thread.joinable(); }
+
+	// Simulation thread only from here on
+
+	// the next thing that happened on the network, in the order it happened
+	bool nextEvent(Event& event);
+	void sendToAll(const char* packets, int totalSize);
+	void sendToClient(unsigned int id, const char* packets, int totalSize);
+	// hands everything sent since the last call to the network thread
+	void endTick();
+	// inbound queue stats, since the last call
+	void printStats();
+
+private:
+	static constexpr size_t QUEUE_BATCHES = 256;   // 4 s of ticks
+	static constexpr unsigned int ALL = UINT32_MAX;
+	static constexpr int WAIT_MS = 1;              // longest a sent batch waits for the network thread
+	static constexpr uint64_t STATS_FLUSHES = 64 * 60;
+
+	struct Batch {
+		struct Item {
+			EventKind kind;
+			unsigned int id;     // ALL: sendToAll
+			uint32_t offset, length;
+		};
+		std::vector<Item> items;
+		std::vector<char> bytes;
+		std::chrono::steady_clock::time_point published;
+
+		void add(EventKind kind, unsigned int id, const char* data, uint32_t length);
+	};
+	using BatchQueue = SpscQueue<std::unique_ptr<Batch>, QUEUE_BATCHES>;
+
+	struct QueueStats {
+		uint64_t batches = 0;
+		size_t deepest = 0;
+		LatencyHistogram latency;
+
+		void popped(const Batch& batch, size_t depth);
+		void print(const char* direction);
+	};
+
+	void run();
+	void read(Batch& batch);
+	void send(Batch& batch);
+
+	ServerNetwork* network;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	BatchQueue inbound;     // network -> simulation
+	BatchQueue outbound;    // simulation -> network
+
+	// network thread
+	unsigned int nextId = 0;
+	QueueStats outStats;
+
+	// simulation thread
+	std::unique_ptr<Batch> received;     // handed out by nextEvent
+	size_t receivedItem = 0;
+	std::unique_ptr<Batch> sending = std::make_unique<Batch>();
+	QueueStats inStats;
+};
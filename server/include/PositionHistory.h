@@ -0,0 +1,32 @@
+#pragma once
+#include "NetworkData.h"
+#include <array>
+#include <cstdint>
+
+// Where every player stood over the last CAPACITY ticks.
+//
+// A client draws the other players a few ticks in the past, so a swing that
+// lands on screen would miss the runner where the server has them now. The
+// hunter's MOVE says which tick they had on screen, and the swing is checked
+// against the runners put back to that tick. Fixed size and written once a
+// tick; looking a player up is one slot, so a swing costs O(players).
+class PositionHistory {
+public:
+	static constexpr uint32_t CAPACITY = 64;   // 1 s at 64 ticks/s
+	static constexpr int PLAYERS = 4;
+
+	// keeps the players of `state` as they are at state.tick
+	void record(const GameState& state);
+	// forgets every tick, when the players are put back at their spawns
+	void clear();
+	// moves `player` to where player `id` was at `tick`; false, leaving it
+	// where it is, when that tick is no longer or was never kept
+	bool rewind(uint64_t tick, int id, PlayerState& player) const;
+
+private:
+	struct Frame {
+		uint64_t tick = UINT64_MAX;   // none
+		float pos[PLAYERS][3];
+	};
+	std::array<Frame, CAPACITY> frames;
+};
@@ -1,25 +1,59 @@
 ﻿#pragma once
-#include "ServerNetwork.h"
+#include "NetworkThread.h"
 #include "NetworkData.h"
-#include "ReadData.h"
-#include "Timer.h"
+#include "TimerWheel.h"
+#include "TickScheduler.h"
+#include "TickProfiler.h"
+#include "PlayerMovement.h"
+#include "InputQueue.h"
+#include "PositionHistory.h"
+#include "AttackCone.h"
+#include "InputLog.h"
+#include "Snapshot.h"
 #include <chrono>
 #include <thread>
 #include <cstdint>
 #include <vector>
 #include <array>
 #include <unordered_map>
-#include <DirectXMath.h>
+#include <map>
+#include <set>
+#include <optional>
 #include <random>
-#include <mutex>
 
 class ServerGame {
 public:
-	ServerGame(void);
+	// A headless server opens no sockets: clients join with connectHeadless()
+	// and their packets are handed over with queuePacket(). `seed` seeds the
+	// game RNG of a headless server so runs can be repeated.
+	explicit ServerGame(bool headless = false, unsigned int seed = 0);
 	~ServerGame(void);
 
+	// waits for the next tick and runs it, several back to back after a stall
 	void update();
+	// runs one simulation tick right away
+	void step();
+	unsigned int connectHeadless();
+	// queues packets from client `id`, applied on the next step()
+	void queuePacket(unsigned int id, const char* data, int length);
+	const GameState& gameState() const { return *state; }
+	GamePhase gamePhase() const { return appState->gamePhase; }
+	uint64_t roundsPlayed() const { return roundsStarted; }
+	uint64_t gamesPlayed() const { return gamesFinished; }
+	// every client's input queue counters since they were last printed
+	InputQueue::Stats inputStats() const;
+	// logs every packet applied from now on, with the RNG seed, for runReplay
+	bool startRecording(const wchar_t* fileAddr);
+	void setCatchUp(TickScheduler::CatchUp mode, uint32_t maxSteps);
+	// sends the GameState struct as it is in memory instead of snapshots, so
+	// packet captures can be read without the decoder
+	void setRawState(bool raw) { rawState = raw; }
+	// drops and delays what goes out to UDP clients
+	void simulateLoss(const LossSimulator& loss);
+	// how far back a swing may check the runners the hunter saw, 0 for not at all
+	void setMaxRewind(uint32_t ticks);
 	void receiveFromClients();
+	void handlePackets(unsigned int id, char* data, int length);
 	void sendGameStateUpdates();
 	void sendAppPhaseUpdates();
 	void sendShopOptions(ShopOptionsPayload*);
@@ -29,10 +63,12 @@ public:
 	void applyMovements();
 	void applyCamera();
 	void applyPhysics();
-	void updateClientPositionWithCollision(unsigned int, float, float, float);
 	void applyAttacks();
-	void applyDodge();
 	void readBoundingBoxes();
+	// see PlayerMovement::loadCollision
+	bool loadCollision(const wchar_t* bakedAddr, const wchar_t* jsonAddr);
+	// converts a JSON export into a baked collision file, returns the exit code
+	static int bakeCollision(const wchar_t* jsonAddr, const wchar_t* bakedAddr);
 	void handleGamePhase();
 	void handleStartMenu();
 	void handleEndPhase();
@@ -40,6 +76,7 @@ public:
 	void resetGamePos();
 
 	void startARound(int);
+	void endRound();
 	void handleShopPhase();
 	void startShopPhase();
 	void applyPowerups(uint8_t, uint8_t);
@@ -50,13 +87,34 @@ public:
 	void sendInstinctUpdate(uint64_t);
 
 private:
-	static constexpr int TICKS_PER_SEC = 64;
-	static constexpr std::chrono::milliseconds TICK_DURATION{ 1000 / TICKS_PER_SEC };
+	static constexpr int TICKS_PER_SEC = PlayerMovement::TICKS_PER_SEC;
+	static constexpr uint32_t MAX_CATCH_UP_TICKS = 4;
+	static constexpr uint64_t STATS_INTERVAL_TICKS = TICKS_PER_SEC * 60;
 	static unsigned int client_id;
 
-	std::chrono::steady_clock::time_point next_tick = std::chrono::steady_clock::now();
-	ServerNetwork* network;
-	char network_data[MAX_PACKET_SIZE];
+	TickScheduler scheduler{ TICKS_PER_SEC, TickScheduler::CatchUp::BURST, MAX_CATCH_UP_TICKS };
+	uint64_t lastStatsTick = 0;
+#if TICK_PROFILE
+	// per-phase times of step(), written with the scheduler stats and on exit
+	static constexpr const char* PROFILE_FILE = "tick_profile.txt";
+	static constexpr uint64_t TICK_BUDGET_NS = 1'000'000'000ull / TICKS_PER_SEC;
+	TickProfiler profiler;
+#endif
+	NetworkThread* network;   // null when headless
+	std::set<unsigned int> clients;   // connected, as the network thread last told
+	// packets queued for each headless client
+	std::map<unsigned int, std::vector<char>> headlessInbox;
+	void sendToAll(char* packets, int totalSize);
+	void sendToClient(unsigned int id, char* packets, int totalSize);
+	InputRecorder* recorder = nullptr;
+
+	// Every GameState sent is kept for a while so the next one can go out as
+	// a delta against whatever each client acknowledged last
+	bool rawState = false;
+	uint32_t snapshotSequence = 0;
+	SnapshotHistory snapshotHistory;
+	std::map<unsigned int, uint32_t> snapshotAcked;   // 0 until the client acks one
+	uint64_t snapshotsSent = 0, snapshotKeyframes = 0, snapshotBytes = 0;
 
 	int runner_time, hunter_time; // times for each of the players to start moving
 	int runner_points, hunter_points; // points for each of the players
@@ -84,17 +142,17 @@ private:
 		{ -2.075, 2.536, 0.913247 },
 	};
 
-	/* Collision */
-	// each box → 6 floats: {min.x, min.y, min.z, max.x, max.y, max.z}
-	vector<BoundingBox> boxes2d;
-	// colors2d[i][0..3] = R, G, B, A (0–255)
-	vector<vector<int>> colors2d;
+	/* Movement and collision, shared with the client's prediction */
+	PlayerMovement movement;
 
 	int num_players = 4;
 	int round_id;
 	bool tiebreaker;
+	uint64_t roundsStarted = 0;     // over every game, round_id restarts each game
+	uint64_t gamesFinished = 0;
 
 	std::random_device dev;
+	unsigned int rngSeed;   // kept for the input log
 	std::mt19937 rng;
 	std::uniform_int_distribution<std::mt19937::result_type> randomSpawnLocationGen;
 
@@ -102,24 +160,26 @@ private:
 	/* State */
 	AppState* appState;
 	GameState* state;
-	// synchornize access to states
-	mutex state_mu;
-	std::unordered_map<uint8_t, MovePayload> latestMovement;
+	// MOVE commands of each client, one applied a tick; the sequence of the
+	// last one applied is echoed in the client's snapshots
+	std::map<unsigned int, InputQueue> inputs;
 	std::unordered_map<uint8_t, CameraPayload> latestCamera;
 	// indicate whether each player is ready to move on to next phase
 	std::unordered_map<uint8_t, bool> phaseStatus;
-	// One timer object
-	Timer* timer;
+	// Every timed event (round end, powerups, dodge windows) expires through
+	// this wheel, advanced to state->tick at the start of each update
+	TimerWheel timers;
+	TimerWheel::Handle roundEnd;
+	uint64_t roundStartTick = 0;
+	uint64_t roundEndTick = 0;
 
 	/* Attack */
 	std::unordered_map<unsigned, AttackPayload> latestAttacks;
 	static constexpr uint32_t windupTicks = 25;                    // <0.5 s, matches animation
 	static constexpr uint32_t cdDefaultTicks = TICKS_PER_SEC * 2;     // 2 s
 	static constexpr uint32_t slowTicks = 32;                    // 0.5 s
-	static constexpr float hunterSlowFactor = 0.2f;
 
-	uint64_t hunterStartSlowdown = 0;
-	uint64_t hunterEndSlowdown = 0;   // wind-up + cool-down window ends at tick
+	TimerWheel::Handle hunterRecovery;   // pending until the wind-up + cool-down window ends
 
 	struct DelayedAttack { AttackPayload attack; uint64_t hitTick; };
 	std::optional<DelayedAttack> pendingSwing;
@@ -132,7 +192,17 @@ private:
 	static constexpr int INSTINCT_INTERVAL = 2 * TICKS_PER_SEC;
 	static constexpr int INSTINCT_DURATION = 4 * TICKS_PER_SEC;
 
-	bool isHit_(const AttackPayload& a, const PlayerState& victim);
+	// candidates of the swing being resolved, tested all at once
+	SwingTargets swingTargets;
+	std::array<uint8_t, SwingTargets::MAX> swingVictims;   // player id of each target
+
+	// Lag compensation: swings are checked against the runners as they were
+	// at the tick the hunter had on screen, at most maxRewindTicks ago
+	static constexpr uint32_t MAX_REWIND_DEFAULT_TICKS = TICKS_PER_SEC / 4;   // 250 ms
+	uint32_t maxRewindTicks = MAX_REWIND_DEFAULT_TICKS;
+	PositionHistory positionHistory;
+	std::array<uint32_t, 4> viewTicks{};   // of each player's last applied MOVE
+	uint64_t seenTick(unsigned int id) const;
 
 	// Dodge
 	static constexpr uint8_t DODGE_COOLDOWN_DEFAULT_TICKS = TICKS_PER_SEC * 2;   // 2 s  (change to 60 if desired)
@@ -141,9 +211,9 @@ private:
 	static constexpr float    DASH_COOLDOWN_PENALTY = 0.05f; // run speed while on cooldown
 	static constexpr float    REDUCE_DODGE_CD_MULTIPLIER = 0.75f; // each time powerup is bought, reduce cooldown by 0.75x
 
-	std::array<uint64_t, 4> lastDodgeTick{ 0,0,0,0 };    // when each survivor last dodged
-	std::array<int8_t, 4> invulTicks{ 0,0,0,0 };    // frames of invulnerability left
-	std::array<int8_t, 4> dashTicks{ -1,-1,-1,-1 };    // frames of dash‑speed left
+	std::array<TimerWheel::Handle, 4> invulEnd;    // pending while a survivor is invulnerable
+	std::array<TimerWheel::Handle, 4> dashEnd;    // pending while a survivor dashes
+	std::array<TimerWheel::Handle, 4> dodgeCooldownEnd;    // pending until a survivor can dodge again
 	std::array<float, 4> dodgeCooldownTicks{ DODGE_COOLDOWN_DEFAULT_TICKS,DODGE_COOLDOWN_DEFAULT_TICKS,DODGE_COOLDOWN_DEFAULT_TICKS,DODGE_COOLDOWN_DEFAULT_TICKS };    // cooldown of each player
 
 
@@ -154,12 +224,9 @@ private:
 	std::unordered_map<uint8_t, float> extraJumpPowerup;
 	int hasBear[4]{ 0, 0, 0, 0 };
 	int bearTicks = 0;
+	TimerWheel::Handle bearEnd;
 	static constexpr int BEAR_TICKS = TICKS_PER_SEC * 10;
 	static constexpr Point BEAR_POS{ 1.849596, 2.404163, 0.513342 };
-	static constexpr float BEAR_SPEED_MULTIPLIER = 0.75f;
-	static constexpr float BEAR_JUMP_BOOST = 1.0f * PLAYER_SCALING_FACTOR;
-	static constexpr float BEAR_HITBOX = 5.0f * PLAYER_SCALING_FACTOR;
-	int hunterBearStunTicks = 0;
 	static constexpr int BEAR_STUN_TIME = TICKS_PER_SEC * 3;
 	static constexpr float BEAR_STUN_MULTIPLIER = 0.1f;
 	int roundTimeAdjustment = 0;
@@ -171,10 +238,12 @@ private:
 	static constexpr int DEBOUNCE_TICKS = 5;
 	
 	int phantomTicks = 0;
+	TimerWheel::Handle phantomEnd;
 	static constexpr int PHANTOM_TICKS = TICKS_PER_SEC * 5;
 	int hasPhantom = 0;
 	
 	int nocturnalTicks = 0;
+	TimerWheel::Handle nocturnalEnd;
 	static constexpr int NOCTURNAL_TICKS = TICKS_PER_SEC * 5;
 	int hasNocturnal = 0;
 	bool isNocturnal = false;
@@ -183,6 +252,3 @@ private:
 	uint64_t prevInstinctTickStart;
 	uint64_t prevInstinctTickEnd;
 };
-
-static bool checkCollision(BoundingBox, BoundingBox);
-static float findDistance(BoundingBox, BoundingBox, char);
\ No newline at end of file
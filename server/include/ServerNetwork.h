@@ -1,15 +1,20 @@
 #pragma once
+#if defined(_WIN32)
 #include <winsock2.h>
 #include <Windows.h>
 #include <ws2tcpip.h>
+#pragma comment (lib, "Ws2_32.lib")
+#endif
 #include <map>
+#include <vector>
 #include "NetworkServices.h"
 #include "NetworkData.h"
+#include "UdpTransport.h"
+#include "EventLoop.h"
+#include "PacketRing.h"
 
 using namespace std;
 
-#pragma comment (lib, "Ws2_32.lib")
-
 #define DEFAULT_BUFLEN 512
 #define DEFAULT_PORT "2333"
 
@@ -20,14 +25,98 @@ public:
 
 	SOCKET ListenSocket;
 
-	SOCKET ClientSocket;
-
 	int iResult;
 
+	// every client by id, INVALID_SOCKET for the ones on UDP
 	std::map<unsigned int, SOCKET> sessions;
+	// clients closed or timed out since the owner last cleared this
+	std::vector<unsigned int> disconnected;
 
+	// Reads everything waiting on any socket, takes in new connections and
+	// writes out what the kernel would not take before, all from one wait of
+	// at most `timeoutMs`
+	void poll(int timeoutMs = 0);
+	// a connection poll() took in, UDP ones included
 	bool acceptNewClient(unsigned int& id);
-	int receiveData(unsigned int client_id, char* recvbuf);
+	// The next whole packet poll() read from a client, in place, valid until
+	// the next call. False once there are no more this tick.
+	bool nextPacket(unsigned int client_id, PacketRing::View& packet);
+	// Both only queue the packets, flush() sends them
 	void sendToAll(char* packets, int totalSize);
 	void sendToClient(unsigned int client_id, char* packets, int totalSize);
+
+	// Writes out everything queued this tick, one gather-write per TCP client,
+	// sends the UDP acks and resends due, and drops UDP clients gone silent
+	void flush();
+	void simulateLoss(const LossSimulator& loss);
+
+	struct SendStats {
+		uint64_t ticks = 0;        // flush() calls
+		uint64_t sendCalls = 0;    // send/sendto syscalls
+		uint64_t queued = 0;       // sendToAll/sendToClient calls, per client
+		uint64_t bytes = 0;
+	};
+	const SendStats& sendStats() const { return stats; }
+	void resetSendStats() { stats = {}; }
+
+private:
+	// A client's packets for this tick in the order sent, each piece either
+	// in the shared broadcast buffer or in the client's own
+	struct Outbound {
+		struct Piece {
+			bool shared;
+			uint32_t offset, length;
+		};
+		std::vector<Piece> pieces;
+		std::vector<char> own;
+
+		void add(bool shared, uint32_t offset, uint32_t length);
+	};
+
+	// Sockets are non-blocking, so a write the kernel only took part of
+	// leaves the rest in `unsent`, written out once the socket is writable.
+	// Everything sent after it queues behind it.
+	struct TcpPeer {
+		SOCKET sock;
+		Outbound queued;
+		PacketRing inbox;
+		std::vector<char> unsent;
+	};
+	// recv calls per client and tick at most, whatever is left stays in the
+	// kernel for the next tick
+	static constexpr int MAX_READS = 4;
+
+	void acceptPending();
+	void readTcp(unsigned int client_id, TcpPeer& peer);
+	void flushTcp(unsigned int client_id, TcpPeer& peer);
+	void writeUnsent(unsigned int client_id, TcpPeer& peer);
+	// closes a client, only outside of loops over the sessions
+	void disconnect(unsigned int client_id);
+
+	EventLoop events;
+	std::vector<EventLoop::Event> ready;
+	std::vector<SOCKET> accepted;                // connected, not handed out yet
+	std::map<unsigned int, TcpPeer> tcpPeers;
+	std::map<SOCKET, unsigned int> tcpIds;
+	std::vector<unsigned int> closing;           // failed, disconnect() at the end of poll or flush
+
+	std::vector<char> broadcast;                 // sendToAll packets this tick
+	SendStats stats;
+	uint64_t udpCallsBefore = 0;
+
+	// UDP clients share one socket on the game port and are told apart by address
+	struct UdpPeer {
+		sockaddr_in addr;
+		UdpConnection connection;
+		std::vector<char> inbox;    // whole packets
+		size_t inboxRead = 0;       // handed out by nextPacket already
+	};
+
+	void pollUdp();
+	void sendDatagrams(UdpPeer& peer);
+
+	UdpSocket udpSocket;
+	std::map<unsigned int, UdpPeer> udpPeers;
+	std::map<uint64_t, unsigned int> udpIds;    // address -> client id
+	std::vector<UdpPeer> udpNewcomers;          // heard from, not accepted yet
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Each side only writes its own index and reads the
+// other's, with release/acquire ordering publishing the slot contents. The
+// indices live on separate cache lines, and each side caches the other's
+// index so it only touches the shared line when the queue looks full or
+// empty. N must be a power of two.
+template<typename T, size_t N>
+class SpscQueue {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+	// producer: false when full, `value` is then left as it was
+	bool push(T&& value) {
+		size_t head = writeIndex.load(std::memory_order_relaxed);
+		if (head - readCache == N) {
+			readCache = readIndex.load(std::memory_order_acquire);
+			if (head - readCache == N) return false;
+		}
+		slots[head & (N - 1)] = std::move(value);
+		writeIndex.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer: false when empty
+	bool pop(T& value) {
+		size_t tail = readIndex.load(std::memory_order_relaxed);
+		if (tail == writeCache) {
+			writeCache = writeIndex.load(std::memory_order_acquire);
+			if (tail == writeCache) return false;
+		}
+		value = std::move(slots[tail & (N - 1)]);
+		readIndex.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// from either side, a snapshot while the other side keeps going
+	size_t size() const {
+		return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+	}
+
+private:
+	static constexpr size_t CACHE_LINE = 64;
+
+	alignas(CACHE_LINE) std::atomic<size_t> writeIndex{ 0 };
+	size_t readCache = 0;     // producer's last look at readIndex
+	alignas(CACHE_LINE) std::atomic<size_t> readIndex{ 0 };
+	size_t writeCache = 0;    // consumer's last look at writeIndex
+	alignas(CACHE_LINE) std::array<T, N> slots{};
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+// Build with TICK_PROFILE=0 to compile the instrumentation out: the scope
+// macros expand to nothing and ServerGame carries no profiler.
+#ifndef TICK_PROFILE
+#define TICK_PROFILE 1
+#endif
+
+// Latency histogram in the style of HdrHistogram: values below 64 get a
+// bucket each, above that every power of two is split into 32 buckets, so a
+// percentile is within about 3% of the true value from 1 ns up to a minute
+// with a fixed 8 KB table and no allocation when recording.
+class LatencyHistogram {
+public:
+	void record(uint64_t ns);
+	void clear();
+
+	uint64_t count() const { return total; }
+	uint64_t minValue() const { return total ? lowest : 0; }
+	uint64_t maxValue() const { return highest; }
+	double mean() const { return total ? (double)sum / total : 0.0; }
+	// upper bound of the bucket holding the `p` quantile, p in [0, 1]
+	uint64_t percentile(double p) const;
+
+private:
+	static constexpr int SUB_BITS = 5;
+	static constexpr int LINEAR = 2 << SUB_BITS;     // 64 exact buckets
+	static constexpr int MAX_EXP = 36;               // 2^36 ns, about 69 s
+	static constexpr int BUCKETS = LINEAR + (MAX_EXP - SUB_BITS - 1) * (1 << SUB_BITS);
+
+	static int bucketOf(uint64_t ns);
+	static uint64_t bucketTop(int bucket);
+
+	std::array<uint64_t, BUCKETS> counts{};
+	uint64_t total = 0;
+	uint64_t sum = 0;
+	uint64_t lowest = UINT64_MAX;
+	uint64_t highest = 0;
+};
+
+// Wall time spent in each phase of ServerGame::step(), one histogram per
+// phase. Instrument a phase with PROFILE_SCOPE(profiler, PHASE) at the top of
+// the block to time.
+class TickProfiler {
+public:
+	enum class Phase : int {
+		TICK,          // the whole step
+		TIMERS,
+		RECEIVE,
+		MOVEMENTS,
+		CAMERA,
+		PHYSICS,
+		ATTACKS,
+		INSTINCT,
+		SEND_STATE,
+		GAME_PHASE,
+		MENU,          // start menu, shop and end screens
+		ANIMATIONS,
+		FLUSH,         // the network writes queued during the tick
+		COUNT
+	};
+
+	class Scope {
+	public:
+		Scope(TickProfiler& profiler, Phase phase)
+			: profiler(profiler), phase(phase), start(std::chrono::steady_clock::now()) {
+		}
+		~Scope() {
+			profiler.record(phase, std::chrono::steady_clock::now() - start);
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		TickProfiler& profiler;
+		Phase phase;
+		std::chrono::steady_clock::time_point start;
+	};
+
+	void record(Phase phase, std::chrono::steady_clock::duration elapsed) {
+		phases[(int)phase].record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+
+	// Overwrites `fileAddr` with a table of every phase: samples, mean, p50,
+	// p90, p99, p99.9 and max in microseconds, and p99 as a share of `budgetNs`.
+	bool dump(const char* fileAddr, uint64_t budgetNs) const;
+	void clear();
+
+	const LatencyHistogram& histogram(Phase phase) const { return phases[(int)phase]; }
+	static const char* name(Phase phase);
+
+private:
+	std::array<LatencyHistogram, (size_t)Phase::COUNT> phases;
+	std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if TICK_PROFILE
+#define PROFILE_SCOPE(profiler, phase) \
+	TickProfiler::Scope PROFILE_CONCAT(profileScope, __LINE__)((profiler), TickProfiler::Phase::phase)
+#else
+#define PROFILE_SCOPE(profiler, phase) ((void)0)
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Paces the game loop at a fixed tick rate.
+//
+// Deadlines are absolute: tick n is due at start + n * period, computed in
+// nanoseconds from the tick rate, so neither oversleeping nor a period that
+// does not divide a millisecond adds up over time. wait() sleeps until shortly
+// before the deadline and spins the rest, since a plain sleep can wake up a
+// whole scheduler quantum late.
+//
+// When the loop falls behind (a stall, a slow tick), the catch-up mode decides
+// what happens to the deadlines that already passed.
+class TickScheduler {
+public:
+	enum class CatchUp {
+		SKIP,   // drop the missed ticks and carry on with the next deadline
+		BURST,  // run the missed ticks back to back, at most maxCatchUp per wait
+	};
+
+	struct Stats {
+		uint64_t ticks = 0;         // simulation steps handed out
+		uint64_t overruns = 0;      // waits that started after their deadline
+		uint64_t caughtUp = 0;      // extra steps run back to back (BURST)
+		uint64_t skipped = 0;       // deadlines dropped without a step
+		int64_t  lateSumNs = 0;     // sum of |wake up - deadline| over on-time ticks
+		int64_t  lateMaxNs = 0;     // worst wake up lateness, on time or not
+		int64_t  sleptNs = 0;       // time blocked in the OS sleep
+		int64_t  spunNs = 0;        // time spent spinning to the deadline
+	};
+
+	explicit TickScheduler(uint32_t ticksPerSec, CatchUp mode = CatchUp::BURST, uint32_t maxCatchUp = 4);
+	~TickScheduler();
+	TickScheduler(const TickScheduler&) = delete;
+	TickScheduler& operator=(const TickScheduler&) = delete;
+
+	void configure(CatchUp mode, uint32_t maxCatchUp);
+
+	// Blocks until the next tick is due and returns how many simulation steps
+	// to run now, at least 1. The first call anchors the schedule and returns
+	// straight away.
+	uint32_t wait();
+
+	const Stats& stats() const { return counters; }
+	void resetStats() { counters = {}; }
+	// prints the counters gathered since the last resetStats()
+	void printStats() const;
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	// switch from sleeping to spinning this long before a deadline
+	static constexpr std::chrono::microseconds SPIN_MARGIN{ 2000 };
+
+	clock::time_point deadline(uint64_t index) const;
+	void sleepUntil(clock::time_point due);
+
+	uint32_t ticksPerSec;
+	CatchUp mode;
+	uint32_t maxCatchUp;
+
+	bool started = false;
+	clock::time_point start;
+	uint64_t next = 0;          // index of the next deadline
+	Stats counters;
+};
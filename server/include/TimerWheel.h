@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Hierarchical timer wheel keyed on the game tick.
+//
+// Driven from the game loop with advance(state->tick), so every callback runs
+// on the simulation thread at the exact tick it was scheduled for; nothing
+// needs a lock. Four levels of 64 slots cover 2^24 ticks (about 3 days at 64
+// ticks/s) and anything further out is parked on the top level and re-filed
+// as it gets closer. Scheduling and cancelling are O(1); each timer is moved
+// down at most once per level before it fires.
+class TimerWheel {
+public:
+	using Callback = std::function<void()>;
+
+	// Identifies a scheduled timer. Stays safe to use after the timer fired or
+	// was cancelled: it then simply is no longer pending.
+	struct Handle {
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+	};
+
+	explicit TimerWheel(uint64_t now = 0);
+
+	// Runs `onExpire` (may be empty) during advance() at `tick`. Timers due on
+	// the same tick fire in the order they were scheduled. A tick that already
+	// passed fires on the next advance().
+	Handle schedule(uint64_t tick, Callback onExpire = nullptr);
+	// returns false if the timer already fired or was cancelled
+	bool cancel(Handle& handle);
+	bool pending(Handle handle) const;
+	// tick a pending timer fires at, 0 if it is not pending
+	uint64_t deadline(Handle handle) const;
+
+	// fires every timer due up to and including `tick`
+	void advance(uint64_t tick);
+	// cancels every timer without firing it
+	void clear();
+
+	uint64_t currentTick() const { return now; }
+	size_t size() const { return active; }
+
+private:
+	static constexpr int      LEVEL_BITS = 6;
+	static constexpr uint32_t SLOTS = 1u << LEVEL_BITS;
+	static constexpr int      LEVELS = 4;
+	static constexpr uint64_t SPAN = 1ull << (LEVEL_BITS * LEVELS);
+	static constexpr uint32_t NONE = UINT32_MAX;
+
+	struct Node {
+		uint64_t deadline = 0;
+		uint64_t seq = 0;         // schedule order, breaks ties on the same tick
+		Callback onExpire;
+		uint32_t prev = NONE, next = NONE;
+		uint32_t generation = 0;
+		uint16_t level = 0, slot = 0;
+		bool     live = false;
+	};
+
+	void link(uint32_t i);
+	void unlink(uint32_t i);
+	void release(uint32_t i);
+	void cascade(int level);
+	bool valid(Handle handle) const;
+
+	std::vector<Node> nodes;
+	std::vector<uint32_t> freeList;
+	std::array<std::array<uint32_t, SLOTS>, LEVELS> slots;
+	// timers due on the tick being fired, with the generation they had
+	std::vector<std::pair<uint32_t, uint32_t>> firing;
+
+	uint64_t now;
+	uint64_t nextSeq = 0;
+	size_t   active = 0;
+};
@@ -0,0 +1,70 @@
+#include "AttackCone.h"
+#include <cmath>
+#include <immintrin.h>
+
+static constexpr float SPHERE_SQUARED = SWING_SPHERE_RADIUS * SWING_SPHERE_RADIUS;
+static constexpr float COS_SQUARED = SWING_COS * SWING_COS;
+
+Swing Swing::from(const AttackPayload& attack, float range) {
+	return { attack.originX, attack.originY, attack.originZ,
+		-sinf(attack.yaw), cosf(attack.yaw), range * range };
+}
+
+bool SwingTargets::push(float px, float py, float pz) {
+	if (count == MAX) return false;
+	x[count] = px;
+	y[count] = py;
+	z[count] = pz;
+	count++;
+	return true;
+}
+
+// -----------------------------------------------------------------------------
+// BATCH KERNELS
+// -----------------------------------------------------------------------------
+//
+// Inside the cone is dot >= cos * length with a positive cosine, which holds
+// exactly when dot >= 0 and dot^2 >= cos^2 * length^2. Both kernels do the
+// same float operations in the same order.
+
+uint32_t swingMask4Scalar(const Swing& s, const SwingTargets& t, size_t first) {
+	uint32_t mask = 0;
+	for (size_t k = 0; k < SWING_BATCH; k++) {
+		size_t i = first + k;
+		float vx = t.x[i] - s.originX;
+		float vy = t.y[i] - s.originY;
+		float vz = t.z[i] - s.originZ;
+		float dist2 = vx * vx + vy * vy + vz * vz;
+		float dot = vx * s.forwardX + vy * s.forwardY;
+		bool inCone = dist2 <= s.rangeSquared && dot >= 0.0f && dot * dot >= COS_SQUARED * dist2;
+		bool hit = dist2 <= SPHERE_SQUARED || inCone;
+		mask |= (uint32_t)hit << k;
+	}
+	return mask;
+}
+
+uint32_t swingMask4Sse(const Swing& s, const SwingTargets& t, size_t first) {
+	__m128 vx = _mm_sub_ps(_mm_loadu_ps(&t.x[first]), _mm_set1_ps(s.originX));
+	__m128 vy = _mm_sub_ps(_mm_loadu_ps(&t.y[first]), _mm_set1_ps(s.originY));
+	__m128 vz = _mm_sub_ps(_mm_loadu_ps(&t.z[first]), _mm_set1_ps(s.originZ));
+	__m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+	__m128 dot = _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(s.forwardX)), _mm_mul_ps(vy, _mm_set1_ps(s.forwardY)));
+
+	__m128 inCone = _mm_cmple_ps(dist2, _mm_set1_ps(s.rangeSquared));
+	inCone = _mm_and_ps(inCone, _mm_cmpge_ps(dot, _mm_setzero_ps()));
+	inCone = _mm_and_ps(inCone, _mm_cmpge_ps(_mm_mul_ps(dot, dot), _mm_mul_ps(_mm_set1_ps(COS_SQUARED), dist2)));
+	__m128 hit = _mm_or_ps(_mm_cmple_ps(dist2, _mm_set1_ps(SPHERE_SQUARED)), inCone);
+	return (uint32_t)_mm_movemask_ps(hit);
+}
+
+uint64_t swingHitMask(const Swing& swing, const SwingTargets& targets) {
+	uint64_t mask = 0;
+	for (size_t i = 0; i < targets.count; i += SWING_BATCH) {
+		mask |= (uint64_t)swingMask4Sse(swing, targets, i) << i;
+	}
+	// the kernels read whole batches, drop what is past the last target
+	if (targets.count < SwingTargets::MAX) {
+		mask &= (1ull << targets.count) - 1;
+	}
+	return mask;
+}
@@ -0,0 +1,546 @@
+#include "Benchmarks.h"
+#include "AttackCone.h"
+#include "CollisionWorld.h"
+#include "Snapshot.h"
+#include "UdpTransport.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <numbers>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// times `fn` over every query and returns the average nanoseconds per query
+template<typename Fn>
+static double timeQueries(const vector<BoundingBox>& queries, Fn fn) {
+	auto start = chrono::steady_clock::now();
+	for (const BoundingBox& q : queries) {
+		fn(q);
+	}
+	auto end = chrono::steady_clock::now();
+	return chrono::duration<double, nano>(end - start).count() / queries.size();
+}
+
+int benchCollision() {
+	static constexpr int NUM_QUERIES = 200000;
+	const wchar_t* fileAddr = L"bb#_bboxes.json";
+
+	vector<BoundingBox> levelBoxes;
+	if (!CollisionWorld::readJson(fileAddr, levelBoxes)) {
+		return 1;
+	}
+	float playerRadius = 1.0f * PLAYER_SCALING_FACTOR;
+	CollisionWorld world;
+	world.build(levelBoxes, { 0.0f, playerRadius });
+	const BoxArrays& all = world.allBoxes(0);
+	const BoxArrays& grown = world.allBoxes(1);
+
+	// player sized boxes scattered over the level, each swept by a random move
+	BoundingBox bounds = levelBoxes[0];
+	for (const BoundingBox& b : levelBoxes) {
+		bounds = { min(bounds.minX, b.minX), min(bounds.minY, b.minY), min(bounds.minZ, b.minZ),
+			max(bounds.maxX, b.maxX), max(bounds.maxY, b.maxY), max(bounds.maxZ, b.maxZ) };
+	}
+	mt19937 gen(125);
+	uniform_real_distribution<float> px(bounds.minX, bounds.maxX), py(bounds.minY, bounds.maxY), pz(bounds.minZ, bounds.maxZ);
+	uniform_real_distribution<float> step(-2.5f * PLAYER_INIT_SPEED, 2.5f * PLAYER_INIT_SPEED);
+
+	vector<BoundingBox> queries(NUM_QUERIES);
+	vector<array<float, 6>> moves(NUM_QUERIES);
+	for (size_t m = 0; m < queries.size(); m++) {
+		float x = px(gen), y = py(gen), z = pz(gen);
+		float dx = step(gen), dy = step(gen), dz = step(gen);
+		moves[m] = { x, y, z, dx, dy, dz };
+		queries[m] = { x - playerRadius + min(dx, 0.0f), y - playerRadius + min(dy, 0.0f), z - playerRadius + min(dz, 0.0f),
+			x + playerRadius + max(dx, 0.0f), y + playerRadius + max(dy, 0.0f), z + playerRadius + max(dz, 0.0f) };
+	}
+
+	// reference hit counts from the scalar kernel, every other path must agree
+	vector<uint32_t> expected(NUM_QUERIES, 0), got(NUM_QUERIES, 0);
+	size_t n = 0;
+	auto fullScan = [&](auto kernel, vector<uint32_t>& hits) {
+		return [&, kernel](const BoundingBox& q) {
+			uint32_t h = 0;
+			for (size_t i = 0; i < all.size(); i += BOX_BATCH) {
+				h += popcount(kernel(q, all, i));
+			}
+			hits[n++] = h;
+		};
+	};
+
+	n = 0;
+	double scalarNs = timeQueries(queries, fullScan(overlapMask8Scalar, expected));
+
+	bool ok = true;
+	auto check = [&](const char* name, double ns, double baseline) {
+		bool match = (got == expected);
+		ok = ok && match;
+		printf("  %-22s %9.1f ns/query  %5.2fx  %s\n", name, ns, baseline / ns, match ? "" : "MISMATCH");
+		fill(got.begin(), got.end(), 0);
+	};
+
+	printf("[BENCH] %zu boxes, %d swept player boxes\n", world.size(), NUM_QUERIES);
+	printf("  %-22s %9.1f ns/query  %5.2fx\n", "full scan, scalar", scalarNs, 1.0);
+
+	n = 0;
+	check("full scan, SSE2", timeQueries(queries, fullScan(overlapMask8Sse, got)), scalarNs);
+
+	if (cpuHasAvx2()) {
+		n = 0;
+		check("full scan, AVX2", timeQueries(queries, fullScan(overlapMask8Avx2, got)), scalarNs);
+	}
+	else {
+		printf("  %-22s (not supported by this CPU)\n", "full scan, AVX2");
+	}
+
+	n = 0;
+	vector<uint32_t> candidates;
+	double gridNs = timeQueries(queries, [&](const BoundingBox& q) {
+		candidates.clear();
+		world.query(0, q, candidates);
+		got[n++] = (uint32_t)candidates.size();
+	});
+	check("grid broad-phase", gridNs, scalarNs);
+
+	// Narrow phase: earliest impact of each move. The old path sweeps the player
+	// box against every candidate; the new one sweeps a point through the level
+	// grown by the player radius. Both must find the same first impact.
+	auto timeMoves = [&](auto fn) {
+		auto start = chrono::steady_clock::now();
+		for (size_t m = 0; m < moves.size(); m++) {
+			fn(m, moves[m].data(), moves[m].data() + 3);
+		}
+		auto end = chrono::steady_clock::now();
+		return chrono::duration<double, nano>(end - start).count() / moves.size();
+	};
+	// first impact per move; the paths round differently, so stop points are compared loosely
+	vector<PointSweep> boxImpact(NUM_QUERIES), pointImpact(NUM_QUERIES);
+
+	double boxNs = timeMoves([&](size_t m, const float* p, const float* d) {
+		candidates.clear();
+		world.query(0, queries[m], candidates);
+		BoundingBox playerBox = { p[0] - playerRadius, p[1] - playerRadius, p[2] - playerRadius,
+			p[0] + playerRadius, p[1] + playerRadius, p[2] + playerRadius };
+		float firstHit = 1.0f;
+		int hitAxis = -1;
+		for (uint32_t b : candidates) {
+			float t;
+			int axis;
+			if (sweepBox(playerBox, d, world.box(0, b), t, axis) && t < firstHit) {
+				firstHit = t;
+				hitAxis = axis;
+			}
+		}
+		boxImpact[m].t = firstHit;
+		boxImpact[m].axis = hitAxis;
+	});
+
+	// every point kernel over the whole grown level must agree exactly with the scalar one
+	vector<PointSweep> expectedSweep(NUM_QUERIES);
+	size_t pointMismatches = 0;
+	auto pointScan = [&](auto kernel, bool reference) {
+		return [&, kernel, reference](size_t m, const float* p, const float* d) {
+			PointSweep hit;
+			for (size_t i = 0; i < grown.size(); i += BOX_BATCH) {
+				kernel(p, d, grown, i, 0b111u, hit);
+			}
+			if (reference) {
+				expectedSweep[m] = hit;
+			}
+			else {
+				const PointSweep& e = expectedSweep[m];
+				pointMismatches += !(hit.t == e.t && hit.axis == e.axis && hit.index == e.index);
+			}
+		};
+	};
+
+	printf("[BENCH] first impact of %d moves\n", NUM_QUERIES);
+	double pointScalarNs = timeMoves(pointScan(sweepPoint8Scalar, true));
+	printf("  %-22s %9.1f ns/move   %5.2fx\n", "point scan, scalar", pointScalarNs, 1.0);
+	auto checkPoint = [&](const char* name, double ns) {
+		ok = ok && pointMismatches == 0;
+		printf("  %-22s %9.1f ns/move   %5.2fx  %s\n", name, ns, pointScalarNs / ns, pointMismatches ? "MISMATCH" : "");
+		pointMismatches = 0;
+	};
+	checkPoint("point scan, SSE2", timeMoves(pointScan(sweepPoint8Sse, false)));
+	if (cpuHasAvx2()) {
+		checkPoint("point scan, AVX2", timeMoves(pointScan(sweepPoint8Avx2, false)));
+	}
+
+	printf("  %-22s %9.1f ns/move   %5.2fx\n", "grid + box sweep", boxNs, 1.0);
+	double pointNs = timeMoves([&](size_t m, const float* p, const float* d) {
+		PointSweep hit;
+		world.sweepPoint(1, p, d, 0b111u, hit);
+		pointImpact[m] = hit;
+	});
+	size_t differ = 0;
+	for (size_t m = 0; m < moves.size(); m++) {
+		// compare where the move stops, small deltas magnify rounding in t
+		const float* d = moves[m].data() + 3;
+		float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		differ += (boxImpact[m].axis != pointImpact[m].axis || fabsf(boxImpact[m].t - pointImpact[m].t) * length > 1e-6f);
+	}
+	ok = ok && differ == 0;
+	printf("  %-22s %9.1f ns/move   %5.2fx  %s\n", "grid + point sweep", pointNs, boxNs / pointNs, differ ? "MISMATCH" : "");
+	if (differ) {
+		printf("  %zu moves found a different first impact\n", differ);
+	}
+
+	return ok ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// SNAPSHOTS
+// -----------------------------------------------------------------------------
+
+// A made up match: a hunter and three runners walking about the room with
+// pauses, turning, looking up and down and jumping, the round timer running
+static vector<GameState> playMatch(int ticks, mt19937& gen) {
+	static constexpr float ROOM_MIN[2] = { -3.0f, -2.1f };
+	static constexpr float ROOM_MAX[2] = { 3.0f, 3.8f };
+	uniform_real_distribution<float> turn(-3.14159f, 3.14159f);
+	uniform_int_distribution<int> roll(0, 255), wait(32, 256);
+
+	GameState state{};
+	int nextChange[4] = {};
+	bool walking[4] = {};
+	for (int i = 0; i < 4; i++) {
+		PlayerState& p = state.players[i];
+		p = { -2.3f + 0.075f * i, 2.536f, 0.0f, startYaw, startPitch, 0.0f,
+			i == 0 ? HUNTER_INIT_SPEED : PLAYER_INIT_SPEED, PLAYER_INIT_COINS, i == 0, false, true, false, false, 1, 1, false, 0, 0, 0, 0 };
+	}
+
+	vector<GameState> states;
+	states.reserve(ticks);
+	for (int t = 1; t <= ticks; t++) {
+		state.tick = t;
+		state.timerFrac = (float)(t % (ROUND_DURATION * 64)) / (ROUND_DURATION * 64);
+		for (int i = 0; i < 4; i++) {
+			PlayerState& p = state.players[i];
+			if (t >= nextChange[i]) {
+				walking[i] = roll(gen) < 192;
+				p.yaw = turn(gen);
+				nextChange[i] = t + wait(gen);
+			}
+			if (walking[i]) {
+				p.x = clamp(p.x - sinf(p.yaw) * p.speed, ROOM_MIN[0], ROOM_MAX[0]);
+				p.y = clamp(p.y + cosf(p.yaw) * p.speed, ROOM_MIN[1], ROOM_MAX[1]);
+				p.pitch = clamp(p.pitch + (roll(gen) - 128) / 4096.0f, -1.5f, 1.5f);
+				if (p.isGrounded && roll(gen) < 4) {
+					p.zVelocity = JUMP_VELOCITY;
+					p.isGrounded = false;
+					p.availableJumps = 0;
+				}
+			}
+			if (!p.isGrounded) {
+				p.zVelocity -= GRAVITY;
+				p.z += p.zVelocity;
+				if (p.z <= 0.0f) {
+					p.z = 0.0f;
+					p.zVelocity = 0.0f;
+					p.isGrounded = true;
+					p.availableJumps = p.jumpCounts;
+				}
+			}
+		}
+		states.push_back(state);
+	}
+	return states;
+}
+
+int benchSnapshot() {
+	static constexpr int NUM_TICKS = 64 * 60 * 5;
+	static constexpr int PASSES = 10;
+	// snapshots in flight, an ack arrives this many ticks after its snapshot
+	static constexpr uint32_t ACK_DELAY = 4;
+
+	mt19937 gen(125);
+	vector<GameState> states = playMatch(NUM_TICKS, gen);
+
+	vector<uint8_t> wire(states.size() * Snapshot::MAX_SIZE);
+	vector<size_t> sizes(states.size());
+	auto encodeAll = [&](bool keyframes) {
+		SnapshotHistory sent;
+		auto start = chrono::steady_clock::now();
+		for (int pass = 0; pass < PASSES; pass++) {
+			for (uint32_t seq = 1; seq <= states.size(); seq++) {
+				const GameState& state = states[seq - 1];
+				sent.push(seq, state);
+				uint32_t acked = keyframes || seq <= ACK_DELAY ? 0 : seq - ACK_DELAY;
+				// the client sends an input a tick, so its ack climbs as fast as the sequence
+				sizes[seq - 1] = Snapshot::encode(state, seq, sent.find(acked), acked, seq, &wire[(seq - 1) * Snapshot::MAX_SIZE]);
+			}
+		}
+		return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (PASSES * states.size());
+	};
+
+	bool ok = true;
+	float maxError = 0.0f;
+	auto decodeAll = [&]() {
+		SnapshotHistory received;
+		GameState state;
+		uint32_t seq, input;
+		auto start = chrono::steady_clock::now();
+		for (int pass = 0; pass < PASSES; pass++) {
+			for (size_t i = 0; i < states.size(); i++) {
+				ok = received.decode(&wire[i * Snapshot::MAX_SIZE], sizes[i], state, seq, input) && ok;
+				received.push(seq, state);
+			}
+		}
+		double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / (PASSES * states.size());
+		// the last pass again, untimed, for the rounding error
+		for (size_t i = 0; i < states.size(); i++) {
+			ok = received.decode(&wire[i * Snapshot::MAX_SIZE], sizes[i], state, seq, input) && input == seq && ok;
+			received.push(seq, state);
+			for (int p = 0; p < 4; p++) {
+				const PlayerState& a = state.players[p];
+				const PlayerState& b = states[i].players[p];
+				maxError = max({ maxError, fabsf(a.x - b.x), fabsf(a.y - b.y), fabsf(a.z - b.z) });
+			}
+		}
+		return ns;
+	};
+	auto averageSize = [&]() {
+		size_t total = 0;
+		for (size_t size : sizes) total += HDR_SIZE + size;
+		return (double)total / sizes.size();
+	};
+
+	size_t rawSize = HDR_SIZE + sizeof(GameState);
+	printf("[BENCH] %zu snapshots of a made up match, acks %u ticks behind\n", states.size(), ACK_DELAY);
+	printf("  %-22s %9zu bytes\n", "raw GameState", rawSize);
+
+	double encodeNs = encodeAll(true);
+	double decodeNs = decodeAll();
+	double size = averageSize();
+	printf("  %-22s %9.1f bytes  %5.2fx  encode %6.1f ns  decode %6.1f ns\n", "keyframe", size, rawSize / size, encodeNs, decodeNs);
+
+	encodeNs = encodeAll(false);
+	decodeNs = decodeAll();
+	size = averageSize();
+	printf("  %-22s %9.1f bytes  %5.2fx  encode %6.1f ns  decode %6.1f ns\n", "delta", size, rawSize / size, encodeNs, decodeNs);
+
+	printf("  %-22s %9.2g units  %s\n", "max position error", maxError, ok ? "" : "DECODE FAILED");
+	return ok ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// SWING
+// -----------------------------------------------------------------------------
+
+// one victim at a time, with the square roots and the cosine every call, as
+// the swing used to be resolved
+static bool swingHitOne(const AttackPayload& a, float range, float x, float y, float z) {
+	float fx = -sinf(a.yaw), fy = cosf(a.yaw);
+	float vx = x - a.originX, vy = y - a.originY, vz = z - a.originZ;
+	float dist2 = vx * vx + vy * vy + vz * vz;
+	if (sqrtf(dist2) <= SWING_SPHERE_RADIUS) return true;
+	if (dist2 > range * range) return false;
+	float len = sqrtf(dist2);
+	if (len < 1e-4f) return false;
+	float dot = (vx * fx + vy * fy) / len;
+	return dot >= cosf(ATTACK_ANGLE_DEG * numbers::pi_v<float> / 180.0f);
+}
+
+int benchSwing() {
+	static constexpr int NUM_SWINGS = 200000;
+	const size_t counts[] = { 3, 16, SwingTargets::MAX };
+	// the reach with H_INC_ATTACK_RANGE, at the default one the sphere covers the cone
+	float range = 17.0f * PLAYER_SCALING_FACTOR;
+
+	// swings from random spots with targets scattered around them, some within reach
+	mt19937 gen(125);
+	uniform_real_distribution<float> spot(-3.0f, 3.0f), around(-1.2f * range, 1.2f * range), turn(-4.0f, 4.0f);
+	vector<AttackPayload> swings(NUM_SWINGS);
+	vector<SwingTargets> targets(NUM_SWINGS / 100);
+	for (AttackPayload& a : swings) {
+		a = { spot(gen), spot(gen), 0.0f, turn(gen), 0.0f, range };
+	}
+
+	printf("[BENCH] %d swings, cone %.0f degrees, reach %.3f\n", NUM_SWINGS, ATTACK_ANGLE_DEG, range);
+	bool ok = true;
+	for (size_t count : counts) {
+		for (size_t t = 0; t < targets.size(); t++) {
+			const AttackPayload& a = swings[t];
+			targets[t].clear();
+			for (size_t i = 0; i < count; i++) {
+				targets[t].push(a.originX + around(gen), a.originY + around(gen), a.originZ + around(gen) * 0.25f);
+			}
+		}
+
+		uint64_t hitsOne = 0, hitsScalar = 0, hitsSse = 0;
+		size_t mismatches = 0, differ = 0;
+		auto start = chrono::steady_clock::now();
+		for (size_t s = 0; s < swings.size(); s++) {
+			const SwingTargets& tg = targets[s % targets.size()];
+			for (size_t i = 0; i < tg.count; i++) {
+				hitsOne += swingHitOne(swings[s], range, tg.x[i], tg.y[i], tg.z[i]);
+			}
+		}
+		double oneNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / swings.size();
+
+		auto time = [&](auto kernel, uint64_t& hits) {
+			auto begin = chrono::steady_clock::now();
+			for (size_t s = 0; s < swings.size(); s++) {
+				const SwingTargets& tg = targets[s % targets.size()];
+				Swing swing = Swing::from(swings[s], range);
+				uint64_t mask = 0;
+				for (size_t i = 0; i < tg.count; i += SWING_BATCH) {
+					mask |= (uint64_t)kernel(swing, tg, i) << i;
+				}
+				if (tg.count < SwingTargets::MAX) mask &= (1ull << tg.count) - 1;
+				hits += popcount(mask);
+			}
+			return chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / swings.size();
+		};
+		double scalarNs = time(swingMask4Scalar, hitsScalar);
+		double sseNs = time(swingMask4Sse, hitsSse);
+
+		// every swing again, target by target, for the masks to agree exactly
+		for (size_t s = 0; s < swings.size(); s++) {
+			const SwingTargets& tg = targets[s % targets.size()];
+			Swing swing = Swing::from(swings[s], range);
+			uint64_t batched = swingHitMask(swing, tg);
+			uint64_t scalar = 0;
+			for (size_t i = 0; i < tg.count; i += SWING_BATCH) {
+				scalar |= (uint64_t)swingMask4Scalar(swing, tg, i) << i;
+			}
+			if (tg.count < SwingTargets::MAX) scalar &= (1ull << tg.count) - 1;
+			mismatches += batched != scalar;
+			for (size_t i = 0; i < tg.count; i++) {
+				differ += ((batched >> i) & 1) != (uint64_t)swingHitOne(swings[s], range, tg.x[i], tg.y[i], tg.z[i]);
+			}
+		}
+		ok = ok && mismatches == 0 && hitsScalar == hitsSse;
+
+		printf("  %zu targets, %.1f%% hit\n", count, 100.0 * hitsOne / ((double)swings.size() * count));
+		printf("    %-20s %9.1f ns/swing  %5.2fx\n", "one at a time", oneNs, 1.0);
+		printf("    %-20s %9.1f ns/swing  %5.2fx\n", "batched, scalar", scalarNs, oneNs / scalarNs);
+		printf("    %-20s %9.1f ns/swing  %5.2fx  %s\n", "batched, SSE2", sseNs, oneNs / sseNs, mismatches ? "MISMATCH" : "");
+		if (differ) {
+			printf("    %zu targets on the edge judged differently than with square roots\n", differ);
+		}
+	}
+	return ok ? 0 : 1;
+}
+
+// -----------------------------------------------------------------------------
+// UDP
+// -----------------------------------------------------------------------------
+
+// one end of the loopback test: a socket, the connection to the other end
+// and what arrived so far
+struct LoopbackEnd {
+	UdpSocket socket;
+	sockaddr_in peer;
+	UdpConnection connection;
+	vector<char> delivered;
+
+	void send(PacketType type, uint32_t counter, uint64_t now) {
+		char packet[HDR_SIZE + sizeof counter];
+		NetworkServices::buildPacket(type, counter, packet);
+		connection.send(packet, sizeof packet, now);
+	}
+
+	void pump(uint64_t now) {
+		sockaddr_in from;
+		vector<uint8_t> datagram;
+		while (socket.receive(from, datagram)) {
+			connection.receive(datagram.data(), datagram.size(), now, delivered);
+		}
+		connection.update(now);
+		for (const auto& out : connection.outgoing) {
+			socket.sendTo(peer, out.data(), out.size());
+		}
+		connection.outgoing.clear();
+		socket.flush(now);
+	}
+};
+
+int benchUdp(float lossPercent) {
+	static constexpr uint64_t SEND_MS = 3000;
+	static constexpr uint64_t DRAIN_MS = 2000;
+	static constexpr uint64_t TICK_MS = 16;
+	static constexpr int RELIABLE_EVERY = 4;   // ticks between reliable packets
+	LossSimulator loss{ lossPercent, 40, 20 };
+
+#if defined(_WIN32)
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+	LoopbackEnd ends[2];
+	for (int e = 0; e < 2; e++) {
+		if (!ends[e].socket.open(0)) return 1;
+		ends[e].socket.simulate(loss, 125 + e);
+	}
+	for (int e = 0; e < 2; e++) {
+		memset(&ends[e].peer, 0, sizeof(ends[e].peer));
+		ends[e].peer.sin_family = AF_INET;
+		ends[e].peer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		ends[e].peer.sin_port = htons(ends[1 - e].socket.port());
+	}
+
+	// the server end sends snapshots and reliable phase changes, the client
+	// end camera turns and reliable ready-ups, each numbered in order; not
+	// moves, those skip the sequenced ordering for the input queue to do
+	uint32_t unreliableSent[2] = {}, reliableSent[2] = {};
+	uint64_t start = udpNowMs(), nextTick = start;
+	while (udpNowMs() - start < SEND_MS + DRAIN_MS) {
+		uint64_t now = udpNowMs();
+		if (now >= nextTick && now - start < SEND_MS) {
+			nextTick += TICK_MS;
+			ends[0].send(PacketType::SNAPSHOT, unreliableSent[0]++, now);
+			ends[1].send(PacketType::CAMERA, unreliableSent[1]++, now);
+			if (unreliableSent[0] % RELIABLE_EVERY == 0) {
+				ends[0].send(PacketType::APP_PHASE, reliableSent[0]++, now);
+				ends[1].send(PacketType::PLAYER_READY, reliableSent[1]++, now);
+			}
+		}
+		for (LoopbackEnd& end : ends) {
+			end.pump(now);
+		}
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	printf("[BENCH] UDP over loopback for %llu ms, %.0f%% loss, %u+-%u ms latency each way\n",
+		(unsigned long long)SEND_MS, loss.lossPercent, loss.latencyMs, loss.jitterMs / 2);
+	bool ok = true;
+	const char* names[2] = { "client to server", "server to client" };
+	for (int e = 0; e < 2; e++) {
+		// what end e received, sent by the other end
+		const LoopbackEnd& to = ends[e];
+		int from = 1 - e;
+		uint32_t unreliable = 0, reliable = 0, lastUnreliable = 0;
+		bool inOrder = true;
+		for (size_t i = 0; i + HDR_SIZE + 4 <= to.delivered.size(); i += HDR_SIZE + 4) {
+			PacketHeader hdr;
+			uint32_t counter;
+			memcpy(&hdr, &to.delivered[i], sizeof hdr);
+			memcpy(&counter, &to.delivered[i + HDR_SIZE], sizeof counter);
+			if (channelOf(hdr.type) == Channel::RELIABLE) {
+				inOrder = inOrder && counter == reliable;
+				reliable++;
+			}
+			else {
+				inOrder = inOrder && (unreliable == 0 || counter > lastUnreliable);
+				lastUnreliable = counter;
+				unreliable++;
+			}
+		}
+		bool complete = reliable == reliableSent[from];
+		ok = ok && inOrder && complete;
+		const UdpConnection::Stats& s = ends[from].connection.stats();
+		printf("  %-18s reliable %u/%u  unreliable %u/%u (%.1f%%)  resent %llu  stale %llu  rtt %.1f ms  %s\n",
+			names[e], reliable, reliableSent[from], unreliable, unreliableSent[from], 100.0 * unreliable / max(1u, unreliableSent[from]),
+			(unsigned long long)s.resent, (unsigned long long)to.connection.stats().stale, s.rttMs,
+			!inOrder ? "OUT OF ORDER" : !complete ? "INCOMPLETE" : "");
+	}
+	return ok ? 0 : 1;
+}
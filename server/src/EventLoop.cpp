@@ -0,0 +1,103 @@
+#include "EventLoop.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(_WIN32)
+
+EventLoop::EventLoop() {}
+
+EventLoop::~EventLoop() {}
+
+void EventLoop::add(SOCKET sock) {
+	WSAPOLLFD fd{};
+	fd.fd = sock;
+	fd.events = POLLRDNORM;
+	fds.push_back(fd);
+	count++;
+}
+
+void EventLoop::watchWrite(SOCKET sock, bool on) {
+	for (WSAPOLLFD& fd : fds) {
+		if (fd.fd == sock) fd.events = POLLRDNORM | (on ? POLLWRNORM : 0);
+	}
+}
+
+void EventLoop::remove(SOCKET sock) {
+	auto removed = std::remove_if(fds.begin(), fds.end(), [&](const WSAPOLLFD& fd) { return fd.fd == sock; });
+	count -= fds.end() - removed;
+	fds.erase(removed, fds.end());
+}
+
+int EventLoop::wait(int timeoutMs, std::vector<Event>& events) {
+	events.clear();
+	if (fds.empty()) return 0;
+
+	int n = WSAPoll(fds.data(), (unsigned long)fds.size(), timeoutMs);
+	if (n == SOCKET_ERROR) {
+		printf("WSAPoll failed with error: %d\n", WSAGetLastError());
+		return 0;
+	}
+	for (WSAPOLLFD& fd : fds) {
+		if (!fd.revents) continue;
+		bool failed = (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0;
+		events.push_back({ fd.fd, (fd.revents & POLLRDNORM) != 0 || failed, (fd.revents & POLLWRNORM) != 0, failed });
+		fd.revents = 0;
+	}
+	return (int)events.size();
+}
+
+#else
+
+EventLoop::EventLoop() {
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	if (epollFd < 0) {
+		printf("epoll_create1 failed with error: %d\n", errno);
+		exit(1);
+	}
+}
+
+EventLoop::~EventLoop() {
+	if (epollFd >= 0) close(epollFd);
+}
+
+void EventLoop::add(SOCKET sock) {
+	epoll_event ev{};
+	ev.events = EPOLLIN;
+	ev.data.fd = sock;
+	if (epoll_ctl(epollFd, EPOLL_CTL_ADD, sock, &ev) < 0) {
+		printf("epoll_ctl add failed with error: %d\n", errno);
+		return;
+	}
+	count++;
+}
+
+void EventLoop::watchWrite(SOCKET sock, bool on) {
+	epoll_event ev{};
+	ev.events = EPOLLIN | (on ? (uint32_t)EPOLLOUT : 0u);
+	ev.data.fd = sock;
+	epoll_ctl(epollFd, EPOLL_CTL_MOD, sock, &ev);
+}
+
+void EventLoop::remove(SOCKET sock) {
+	if (epoll_ctl(epollFd, EPOLL_CTL_DEL, sock, nullptr) == 0) count--;
+}
+
+int EventLoop::wait(int timeoutMs, std::vector<Event>& events) {
+	events.clear();
+	ready.resize(std::max<size_t>(count, 1));
+	int n = epoll_wait(epollFd, ready.data(), (int)ready.size(), timeoutMs);
+	if (n < 0) {
+		// a signal cut the wait short, the next one picks up
+		if (errno != EINTR) printf("epoll_wait failed with error: %d\n", errno);
+		return 0;
+	}
+	for (int i = 0; i < n; i++) {
+		uint32_t e = ready[i].events;
+		bool failed = (e & (EPOLLERR | EPOLLHUP)) != 0;
+		events.push_back({ ready[i].data.fd, (e & EPOLLIN) != 0 || failed, (e & EPOLLOUT) != 0, failed });
+	}
+	return n;
+}
+
+#endif
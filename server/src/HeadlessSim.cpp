@@ -0,0 +1,271 @@
+#include "HeadlessSim.h"
+#include "ServerGame.h"
+#include "InputLog.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+static constexpr int NUM_BOTS = 4;
+static constexpr double REAL_TICKS_PER_SEC = 64.0;   // rate of a hosted server
+static constexpr float CHASE_RANGE = 0.6f;        // runners flee inside this
+static constexpr float SWING_RANGE = 0.3f;        // hunter swings inside this
+static constexpr float DODGE_RANGE = 0.25f;       // runners dodge inside this
+
+// MOVEs reach the server through a made up network, so the input queue gets
+// what a real one hands it: each one 0..MAX_JITTER_TICKS late, which also
+// swaps some, 1 in LOSS_ONE_IN lost, 1 in DUPLICATE_ONE_IN twice, and every
+// STALL_EVERY_TICKS nothing for STALL_TICKS, then everything at once
+static constexpr uint64_t MAX_JITTER_TICKS = 3;
+static constexpr int LOSS_ONE_IN = 64;
+static constexpr int DUPLICATE_ONE_IN = 64;
+static constexpr uint64_t STALL_EVERY_TICKS = 640;
+static constexpr uint64_t STALL_TICKS = 10;
+
+struct Bot {
+	unsigned int id = 0;
+	float wanderYaw = 0;
+	uint64_t nextTurn = 0;
+	// phase the bot last sent PLAYER_READY in, so it only readies once
+	GamePhase readyIn = GamePhase::NUM_SCREENS;
+	uint32_t sequence = 0;      // of the last MOVE
+	// MOVEs on the made up network, with the tick each one arrives on
+	vector<pair<uint64_t, MovePayload>> inFlight;
+};
+
+template<typename Payload>
+void send(ServerGame& server, unsigned int id, PacketType type, const Payload& payload) {
+	char buf[HDR_SIZE + sizeof(Payload)];
+	NetworkServices::buildPacket<Payload>(type, payload, buf);
+	server.queuePacket(id, buf, (int)sizeof(buf));
+}
+
+// Numbers `mv` and puts it on the made up network. The bot plays on the state
+// it was just given, which is what it has on screen.
+void sendMove(Bot& bot, MovePayload mv, const GameState& state, mt19937& net) {
+	mv.sequence = ++bot.sequence;
+	mv.viewTick = (uint32_t)state.tick;
+	if (uniform_int_distribution<int>(1, LOSS_ONE_IN)(net) == 1) return;
+	uniform_int_distribution<uint64_t> jitter(0, MAX_JITTER_TICKS);
+	bot.inFlight.push_back({ state.tick + jitter(net), mv });
+	if (uniform_int_distribution<int>(1, DUPLICATE_ONE_IN)(net) == 1) {
+		bot.inFlight.push_back({ state.tick + jitter(net), mv });
+	}
+}
+
+// hands the server the MOVEs that arrive on `tick`, in the order they were sent
+void deliverMoves(ServerGame& server, Bot& bot, uint64_t tick) {
+	uint64_t stallEnd = tick - tick % STALL_EVERY_TICKS + STALL_TICKS;
+	if (tick >= STALL_EVERY_TICKS && tick < stallEnd) return;
+	size_t kept = 0;
+	for (auto& [due, mv] : bot.inFlight) {
+		if (due <= tick) send(server, bot.id, PacketType::MOVE, mv);
+		else bot.inFlight[kept++] = { due, mv };
+	}
+	bot.inFlight.resize(kept);
+}
+
+// yaw that makes a forward move head along (vx, vy), see ServerGame::applyMovements
+float yawTowards(float vx, float vy) {
+	return atan2f(-vx, vy);
+}
+
+// a random powerup for the bot's role that it can pay for, 0 for none
+uint8_t pickPowerup(const PlayerState& player, mt19937& gen) {
+	vector<uint8_t> affordable;
+	for (const auto& [powerup, info] : PowerupInfo) {
+		bool hunterPowerup = powerup < Powerup::RUNNER_POWERUPS;
+		if (hunterPowerup == player.isHunter && info.cost <= player.coins) {
+			affordable.push_back((uint8_t)powerup);
+		}
+	}
+	if (affordable.empty()) return 0;
+	return affordable[uniform_int_distribution<size_t>(0, affordable.size() - 1)(gen)];
+}
+
+void playHunter(ServerGame& server, Bot& bot, const GameState& state, mt19937& gen, mt19937& net) {
+	const PlayerState& me = state.players[bot.id];
+
+	int target = -1;
+	float best = INFINITY;
+	for (int c = 0; c < NUM_BOTS; c++) {
+		const PlayerState& other = state.players[c];
+		if (other.isHunter || other.isDead) continue;
+		float d = hypotf(other.x - me.x, other.y - me.y);
+		if (d < best) {
+			best = d;
+			target = c;
+		}
+	}
+
+	uniform_int_distribution<int> roll(0, 255);
+	MovePayload mv{ { 1, 0, 0 }, me.yaw, me.pitch, roll(gen) < 4, 0, 0 };
+	if (target >= 0) {
+		const PlayerState& prey = state.players[target];
+		mv.yaw = yawTowards(prey.x - me.x, prey.y - me.y);
+		mv.jump = mv.jump || prey.z > me.z + 0.1f;
+		if (best < SWING_RANGE) {
+			send(server, bot.id, PacketType::ATTACK, AttackPayload{ me.x, me.y, me.z, mv.yaw, me.pitch, SWING_RANGE });
+		}
+	}
+	sendMove(bot, mv, state, net);
+
+	// try the active powerups now and then, ignored unless bought
+	if (roll(gen) == 0) send(server, bot.id, PacketType::PHANTOM, PhantomPayload{});
+	if (roll(gen) == 0) send(server, bot.id, PacketType::NOCTURNAL, NocturnalPayload{});
+}
+
+void playRunner(ServerGame& server, Bot& bot, const GameState& state, mt19937& gen, mt19937& net) {
+	const PlayerState& me = state.players[bot.id];
+	if (me.isDead) return;
+
+	uniform_int_distribution<int> roll(0, 255);
+	if (state.tick >= bot.nextTurn) {
+		bot.wanderYaw = uniform_real_distribution<float>(-3.14159f, 3.14159f)(gen);
+		bot.nextTurn = state.tick + uniform_int_distribution<uint64_t>(32, 128)(gen);
+	}
+
+	MovePayload mv{ { 1, 0, 0 }, bot.wanderYaw, me.pitch, roll(gen) < 3, 0, 0 };
+	for (int c = 0; c < NUM_BOTS; c++) {
+		const PlayerState& hunter = state.players[c];
+		if (!hunter.isHunter) continue;
+		float d = hypotf(me.x - hunter.x, me.y - hunter.y);
+		if (d < CHASE_RANGE) {
+			mv.yaw = yawTowards(me.x - hunter.x, me.y - hunter.y);
+		}
+		if (d < DODGE_RANGE) {
+			send(server, bot.id, PacketType::DODGE, DodgePayload{ mv.yaw, me.pitch });
+		}
+	}
+	sendMove(bot, mv, state, net);
+
+	if (roll(gen) == 0) send(server, bot.id, PacketType::BEAR, BearPayload{});
+}
+
+} // namespace
+
+int runHeadless(uint64_t ticks, uint32_t seed, const wchar_t* recordAddr) {
+	ServerGame server(true, seed);
+	server.readBoundingBoxes();
+	if (recordAddr && !server.startRecording(recordAddr)) {
+		return 1;
+	}
+	mt19937 gen(seed);
+	// its own generator, so the network does not change what the bots do
+	mt19937 net(seed + 1);
+
+	Bot bots[NUM_BOTS];
+	for (Bot& bot : bots) {
+		bot.id = server.connectHeadless();
+		send(server, bot.id, PacketType::INIT_CONNECTION, InitPayload{});
+	}
+
+	auto start = chrono::steady_clock::now();
+	for (uint64_t t = 0; t < ticks; t++) {
+		const GameState& state = server.gameState();
+		GamePhase phase = server.gamePhase();
+
+		for (Bot& bot : bots) {
+			const PlayerState& me = state.players[bot.id];
+			if (phase == GamePhase::GAME_PHASE) {
+				bot.readyIn = GamePhase::NUM_SCREENS;
+				if (me.isHunter) playHunter(server, bot, state, gen, net);
+				else playRunner(server, bot, state, gen, net);
+			}
+			else if (bot.readyIn != phase) {
+				// menus: ready up once, buying something in the shop
+				bot.readyIn = phase;
+				uint8_t selection = phase == GamePhase::SHOP_PHASE ? pickPowerup(me, gen) : 0;
+				send(server, bot.id, PacketType::PLAYER_READY, PlayerReadyPayload{ true, selection });
+			}
+			deliverMoves(server, bot, state.tick);
+		}
+
+		server.step();
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	double tickRate = ticks / seconds;
+	fprintf(stderr, "[HEADLESS] %llu ticks in %.2f s: %.0f ticks/s (%.0fx real time)\n",
+		(unsigned long long)ticks, seconds, tickRate, tickRate / REAL_TICKS_PER_SEC);
+	fprintf(stderr, "[HEADLESS] %llu matches, %llu rounds: %.3f matches/s, %.2f rounds/s\n",
+		(unsigned long long)server.gamesPlayed(), (unsigned long long)server.roundsPlayed(),
+		server.gamesPlayed() / seconds, server.roundsPlayed() / seconds);
+	InputQueue::Stats input = server.inputStats();
+	fprintf(stderr, "[HEADLESS] %llu moves applied, %llu repeated (%llu ticks starved); dropped %llu late, %llu duplicate, %llu to catch up\n",
+		(unsigned long long)input.applied, (unsigned long long)input.repeated, (unsigned long long)input.starved,
+		(unsigned long long)input.late, (unsigned long long)input.duplicates, (unsigned long long)input.dropped);
+	return 0;
+}
+
+int runReplay(const wchar_t* logAddr, const wchar_t* statesAddr) {
+	InputLogReader log;
+	if (!log.open(logAddr)) {
+		return 1;
+	}
+
+	ServerGame server(true, (unsigned int)log.seed());
+	server.readBoundingBoxes();
+
+	ofstream statesFile;
+	if (statesAddr) {
+		statesFile.open(filesystem::path(statesAddr), ios::out | ios::binary | ios::trunc);
+		if (!statesFile) {
+			fprintf(stderr, "Cannot write %ls\n", statesAddr);
+			return 1;
+		}
+	}
+
+	uint64_t hash = InputLog::HASH_SEED;
+	vector<uint8_t> packed;
+	auto runUntil = [&](uint64_t tick) {
+		while (server.gameState().tick < tick) {
+			server.step();
+			hash = InputLog::hashState(hash, server.gameState());
+			if (statesFile.is_open()) {
+				packed.clear();
+				InputLog::appendState(packed, server.gameState());
+				statesFile.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+			}
+		}
+	};
+
+	uint64_t packets = 0, checkpoints = 0, mismatches = 0;
+	uint64_t firstMismatch = 0;
+	InputLog::Record record;
+	auto start = chrono::steady_clock::now();
+	while (log.next(record)) {
+		if (record.kind == InputLog::Kind::PACKET) {
+			// applied during the receive step of record.tick
+			runUntil(record.tick - 1);
+			server.queuePacket(record.client, record.data, (int)record.length);
+			packets++;
+		}
+		else if (record.kind == InputLog::Kind::CHECKPOINT) {
+			runUntil(record.tick);
+			checkpoints++;
+			if (hash != record.hash && mismatches++ == 0) {
+				firstMismatch = record.tick;
+			}
+		}
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	uint64_t ticks = server.gameState().tick;
+	fprintf(stderr, "[REPLAY] %llu ticks, %llu packets in %.2f s: %.0f ticks/s (%.0fx real time)\n",
+		(unsigned long long)ticks, (unsigned long long)packets, seconds, ticks / seconds, ticks / seconds / REAL_TICKS_PER_SEC);
+	if (mismatches) {
+		fprintf(stderr, "[REPLAY] %llu of %llu checkpoints differ, first at tick %llu\n",
+			(unsigned long long)mismatches, (unsigned long long)checkpoints, (unsigned long long)firstMismatch);
+		return 1;
+	}
+	fprintf(stderr, "[REPLAY] all %llu checkpoints match the recording\n", (unsigned long long)checkpoints);
+	return 0;
+}
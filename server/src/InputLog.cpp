@@ -0,0 +1,239 @@
+#include "InputLog.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+static constexpr char     INPUT_LOG_MAGIC[4] = { 'T', 'T', 'I', 'N' };
+static constexpr uint32_t INPUT_LOG_VERSION = 2;
+// buffered records are written out once they reach this size, or at a checkpoint
+static constexpr size_t   INPUT_LOG_FLUSH_BYTES = 64 * 1024;
+
+struct InputLogHeader {
+	char     magic[4];
+	uint32_t version;
+	uint64_t seed;
+};
+
+static_assert(sizeof(InputLogHeader) == 16, "header layout is part of the file format");
+
+// -----------------------------------------------------------------------------
+// STATE HASH
+// -----------------------------------------------------------------------------
+
+template<typename T>
+static void put(std::vector<uint8_t>& out, const T& value) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void InputLog::appendState(std::vector<uint8_t>& out, const GameState& state) {
+	put(out, state.tick);
+	for (const PlayerState& p : state.players) {
+		put(out, p.x);
+		put(out, p.y);
+		put(out, p.z);
+		put(out, p.yaw);
+		put(out, p.pitch);
+		put(out, p.zVelocity);
+		put(out, p.speed);
+		put(out, p.coins);
+		put(out, (uint8_t)p.isHunter);
+		put(out, (uint8_t)p.isDead);
+		put(out, (uint8_t)p.isGrounded);
+		put(out, (uint8_t)p.isBear);
+		put(out, (uint8_t)p.isPhantom);
+		put(out, (int32_t)p.jumpCounts);
+		put(out, (int32_t)p.availableJumps);
+		put(out, (uint8_t)p.dodgeCollide);
+		put(out, p.slowedFrom);
+		put(out, p.slowedUntil);
+		put(out, p.stunnedUntil);
+		put(out, p.dodgingUntil);
+	}
+	put(out, state.timerFrac);
+}
+
+uint64_t InputLog::hashState(uint64_t hash, const GameState& state) {
+	thread_local std::vector<uint8_t> bytes;
+	bytes.clear();
+	appendState(bytes, state);
+	for (uint8_t b : bytes) {
+		hash ^= b;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// -----------------------------------------------------------------------------
+// RECORDER
+// -----------------------------------------------------------------------------
+
+InputRecorder::~InputRecorder() {
+	flush();
+}
+
+bool InputRecorder::open(const wchar_t* fileAddr, uint64_t seed) {
+	outFile.open(std::filesystem::path(fileAddr), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!outFile) {
+		fprintf(stderr, "Cannot write input log %ls\n", fileAddr);
+		return false;
+	}
+
+	InputLogHeader header;
+	memcpy(header.magic, INPUT_LOG_MAGIC, sizeof header.magic);
+	header.version = INPUT_LOG_VERSION;
+	header.seed = seed;
+	put(buffer, header);
+	flush();
+	return true;
+}
+
+void InputRecorder::varint(uint64_t value) {
+	while (value >= 0x80) {
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+void InputRecorder::begin(InputLog::Kind kind, uint64_t tick) {
+	buffer.push_back((uint8_t)kind);
+	varint(tick - lastTick);
+	lastTick = tick;
+}
+
+void InputRecorder::packet(uint64_t tick, unsigned int client, const char* data, uint32_t length) {
+	if (!outFile.is_open()) return;
+	packetCount++;
+
+	if (length >= HDR_SIZE) {
+		PacketHeader hdr;
+		memcpy(&hdr, data, sizeof hdr);
+		std::vector<char>& previous = last[{ (uint8_t)client, (uint32_t)hdr.type }];
+		if (previous.size() == length && memcmp(previous.data(), data, length) == 0) {
+			begin(InputLog::Kind::REPEAT, tick);
+			buffer.push_back((uint8_t)client);
+			varint((uint32_t)hdr.type);
+			return;
+		}
+		previous.assign(data, data + length);
+	}
+
+	begin(InputLog::Kind::PACKET, tick);
+	buffer.push_back((uint8_t)client);
+	varint(length);
+	buffer.insert(buffer.end(), data, data + length);
+	if (buffer.size() >= INPUT_LOG_FLUSH_BYTES) flush();
+}
+
+void InputRecorder::endTick(const GameState& state) {
+	if (!outFile.is_open()) return;
+	hash = InputLog::hashState(hash, state);
+	if (state.tick % CHECKPOINT_TICKS != 0) return;
+
+	begin(InputLog::Kind::CHECKPOINT, state.tick);
+	put(buffer, hash);
+	// at most a second of input is lost if the server dies
+	flush();
+}
+
+void InputRecorder::flush() {
+	if (!outFile.is_open() || buffer.empty()) return;
+	outFile.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	outFile.flush();
+	written += buffer.size();
+	buffer.clear();
+}
+
+// -----------------------------------------------------------------------------
+// READER
+// -----------------------------------------------------------------------------
+
+bool InputLogReader::open(const wchar_t* fileAddr) {
+	if (!file.open(fileAddr)) {
+		fprintf(stderr, "Cannot read input log %ls\n", fileAddr);
+		return false;
+	}
+
+	InputLogHeader header;
+	if (file.size() < sizeof header) {
+		fprintf(stderr, "Ignoring input log %ls: too short\n", fileAddr);
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof header);
+	if (memcmp(header.magic, INPUT_LOG_MAGIC, sizeof header.magic) != 0 || header.version != INPUT_LOG_VERSION) {
+		fprintf(stderr, "Ignoring input log %ls: not a version %u input log\n", fileAddr, INPUT_LOG_VERSION);
+		return false;
+	}
+	rngSeed = header.seed;
+	pos = sizeof header;
+	lastTick = 0;
+	last.clear();
+	return true;
+}
+
+bool InputLogReader::varint(uint64_t& value) {
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (pos >= file.size()) return false;
+		uint8_t b = file.data()[pos++];
+		value |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+bool InputLogReader::next(InputLog::Record& record) {
+	const uint8_t* data = file.data();
+	if (pos >= file.size()) return false;
+
+	record = {};
+	record.kind = (InputLog::Kind)data[pos++];
+	uint64_t delta;
+	if (!varint(delta)) return false;
+	record.tick = lastTick + delta;
+
+	switch (record.kind) {
+	case InputLog::Kind::PACKET:
+	{
+		uint64_t length;
+		if (pos >= file.size()) return false;
+		record.client = data[pos++];
+		if (!varint(length) || length > file.size() - pos) return false;
+		record.data = reinterpret_cast<const char*>(data + pos);
+		record.length = (uint32_t)length;
+		pos += length;
+		if (length >= HDR_SIZE) {
+			PacketHeader hdr;
+			memcpy(&hdr, record.data, sizeof hdr);
+			last[{ record.client, (uint32_t)hdr.type }] = { record.data, record.length };
+		}
+		break;
+	}
+	case InputLog::Kind::REPEAT:
+	{
+		uint64_t type;
+		if (pos >= file.size()) return false;
+		record.client = data[pos++];
+		if (!varint(type)) return false;
+		auto it = last.find({ record.client, (uint32_t)type });
+		if (it == last.end()) return false;
+		record.kind = InputLog::Kind::PACKET;
+		record.data = it->second.first;
+		record.length = it->second.second;
+		break;
+	}
+	case InputLog::Kind::CHECKPOINT:
+	{
+		if (file.size() - pos < sizeof record.hash) return false;
+		memcpy(&record.hash, data + pos, sizeof record.hash);
+		pos += sizeof record.hash;
+		break;
+	}
+	default:
+		return false;
+	}
+
+	lastTick = record.tick;
+	return true;
+}
@@ -0,0 +1,126 @@
+#include "InputQueue.h"
+
+// true when sequence `a` comes after `b`, across wrap-around
+static bool newer(uint32_t a, uint32_t b) {
+	return (int32_t)(a - b) > 0;
+}
+
+void InputQueue::Stats::add(const Stats& other) {
+	received += other.received;
+	applied += other.applied;
+	duplicates += other.duplicates;
+	late += other.late;
+	dropped += other.dropped;
+	repeated += other.repeated;
+	starved += other.starved;
+}
+
+void InputQueue::push(const MovePayload& command) {
+	counters.received++;
+	if (command.sequence == 0) {
+		queued[0] = command;
+		count = 1;
+		buffering = false;
+		return;
+	}
+
+	if (!newer(command.sequence, lastSequence)) {
+		if (command.sequence == lastSequence) counters.duplicates++;
+		else counters.late++;
+		return;
+	}
+
+	// in sequence order, UDP hands a swapped pair over as it arrived
+	size_t at = count;
+	while (at > 0 && newer(queued[at - 1].sequence, command.sequence)) {
+		at--;
+	}
+	if (at > 0 && queued[at - 1].sequence == command.sequence) {
+		counters.duplicates++;
+		return;
+	}
+	if (count == CAPACITY) {
+		// a burst bigger than the queue within one tick, next() trims the rest
+		if (at == 0) {
+			counters.dropped++;
+			return;
+		}
+		drop(1);
+		at--;
+	}
+	for (size_t i = count; i > at; i--) {
+		queued[i] = queued[i - 1];
+	}
+	queued[at] = command;
+	count++;
+}
+
+void InputQueue::skip(uint32_t sequence) {
+	if (sequence == 0 || !newer(sequence, lastSequence)) return;
+	size_t older = 0;
+	while (older < count && !newer(queued[older].sequence, sequence)) {
+		older++;
+	}
+	// anything older than a skipped command is too late to apply now
+	counters.late += older;
+	for (size_t i = older; i < count; i++) {
+		queued[i - older] = queued[i];
+	}
+	count -= older;
+	lastSequence = sequence;
+}
+
+void InputQueue::drop(size_t n) {
+	bool jump = false;
+	for (size_t i = 0; i < n; i++) {
+		jump = jump || queued[i].jump;
+	}
+	lastSequence = queued[n - 1].sequence;
+	for (size_t i = n; i < count; i++) {
+		queued[i - n] = queued[i];
+	}
+	count -= n;
+	counters.dropped += n;
+	if (count > 0) queued[0].jump = queued[0].jump || jump;
+}
+
+const MovePayload* InputQueue::next(bool expected) {
+	// more waiting than the jitter calls for: catch up
+	if (count > MAX_DEPTH) {
+		drop(count - TARGET_DEPTH);
+	}
+
+	if (buffering && count >= TARGET_DEPTH) {
+		buffering = false;
+	}
+	if (!buffering && count > 0) {
+		current = queued[0];
+		for (size_t i = 1; i < count; i++) {
+			queued[i - 1] = queued[i];
+		}
+		count--;
+		if (current.sequence != 0) lastSequence = current.sequence;
+		repeatable = current.sequence != 0;
+		repeats = 0;
+		counters.applied++;
+		return &current;
+	}
+
+	// ran dry: refill the buffer before going on, meanwhile keep going the same way
+	buffering = true;
+	if (expected) counters.starved++;
+	if (repeatable && repeats < MAX_REPEATS) {
+		repeats++;
+		if (expected) counters.repeated++;
+		current.jump = false;
+		return &current;
+	}
+	return nullptr;
+}
+
+void InputQueue::clear() {
+	count = 0;
+	buffering = true;
+	repeatable = false;
+	repeats = 0;
+}
@@ -0,0 +1,155 @@
+#include "NetworkThread.h"
+#include <cstdio>
+#include <cstring>
+
+using Clock = std::chrono::steady_clock;
+
+void NetworkThread::Batch::add(EventKind kind, unsigned int id, const char* data, uint32_t length) {
+	items.push_back({ kind, id, (uint32_t)bytes.size(), length });
+	bytes.insert(bytes.end(), data, data + length);
+}
+
+void NetworkThread::QueueStats::popped(const Batch& batch, size_t depth) {
+	batches++;
+	deepest = std::max(deepest, depth);
+	latency.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - batch.published).count());
+}
+
+void NetworkThread::QueueStats::print(const char* direction) {
+	if (batches == 0) return;
+	printf("[NETQ] %s: %llu batches, %zu deep at most, queued avg %.1f us, p99 %.1f us, max %.1f us\n",
+		direction, (unsigned long long)batches, deepest, latency.mean() / 1000.0,
+		latency.percentile(0.99) / 1000.0, latency.maxValue() / 1000.0);
+	batches = 0;
+	deepest = 0;
+	latency.clear();
+}
+
+NetworkThread::NetworkThread(ServerNetwork* network) : network(network) {}
+
+NetworkThread::~NetworkThread() {
+	running = false;
+	if (thread.joinable()) thread.join();
+	delete network;
+}
+
+void NetworkThread::simulateLoss(const LossSimulator& loss) {
+	network->simulateLoss(loss);
+}
+
+void NetworkThread::start() {
+	running = true;
+	thread = std::thread(&NetworkThread::run, this);
+}
+
+// -----------------------------------------------------------------------------
+// NETWORK THREAD
+// -----------------------------------------------------------------------------
+
+void NetworkThread::run() {
+	std::unique_ptr<Batch> reading;
+	std::unique_ptr<Batch> sent;
+	uint64_t flushes = 0;
+	while (running) {
+		// what the simulation sent, a tick at a time and in order
+		while (outbound.pop(sent)) {
+			outStats.popped(*sent, outbound.size() + 1);
+			send(*sent);
+			network->flush();
+			if (++flushes % STATS_FLUSHES == 0) {
+				const ServerNetwork::SendStats& net = network->sendStats();
+				printf("[NET] %.2f send calls a tick for %zu clients, carrying %.1f packet writes and %.0f bytes\n",
+					(double)net.sendCalls / net.ticks, network->sessions.size(),
+					(double)net.queued / net.ticks, (double)net.bytes / net.ticks);
+				network->resetSendStats();
+				outStats.print("out");
+			}
+		}
+
+		// a full queue keeps the last read here, and the sockets unread,
+		// until the simulation catches up
+		if (!reading) reading = std::make_unique<Batch>();
+		if (reading->items.empty()) {
+			network->poll(WAIT_MS);
+			read(*reading);
+			if (reading->items.empty()) continue;
+			reading->published = Clock::now();
+		}
+		if (!inbound.push(std::move(reading))) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(WAIT_MS));
+		}
+	}
+}
+
+void NetworkThread::read(Batch& batch) {
+	unsigned int id = nextId;
+	while (network->acceptNewClient(id)) {
+		batch.add(EventKind::CONNECTED, id, nullptr, 0);
+		id++;
+	}
+	nextId = id;
+
+	PacketRing::View packet;
+	for (auto& [id, sock] : network->sessions) {
+		while (network->nextPacket(id, packet)) {
+			batch.add(EventKind::PACKET, id, packet.data, packet.length);
+		}
+	}
+
+	for (unsigned int id : network->disconnected) {
+		batch.add(EventKind::DISCONNECTED, id, nullptr, 0);
+	}
+	network->disconnected.clear();
+}
+
+void NetworkThread::send(Batch& batch) {
+	for (const Batch::Item& item : batch.items) {
+		char* packets = batch.bytes.data() + item.offset;
+		if (item.id == ALL) {
+			network->sendToAll(packets, (int)item.length);
+		}
+		else {
+			network->sendToClient(item.id, packets, (int)item.length);
+		}
+	}
+}
+
+// -----------------------------------------------------------------------------
+// SIMULATION THREAD
+// -----------------------------------------------------------------------------
+
+bool NetworkThread::nextEvent(Event& event) {
+	while (!received || receivedItem == received->items.size()) {
+		if (!inbound.pop(received)) {
+			received.reset();
+			return false;
+		}
+		inStats.popped(*received, inbound.size() + 1);
+		receivedItem = 0;
+	}
+
+	const Batch::Item& item = received->items[receivedItem++];
+	event = { item.kind, item.id, received->bytes.data() + item.offset, item.length };
+	return true;
+}
+
+void NetworkThread::sendToAll(const char* packets, int totalSize) {
+	sending->add(EventKind::PACKET, ALL, packets, (uint32_t)totalSize);
+}
+
+void NetworkThread::sendToClient(unsigned int id, const char* packets, int totalSize) {
+	sending->add(EventKind::PACKET, id, packets, (uint32_t)totalSize);
+}
+
+void NetworkThread::endTick() {
+	// an empty tick still goes out, the network flushes UDP acks and resends on it
+	sending->published = Clock::now();
+	if (outbound.push(std::move(sending))) {
+		sending = std::make_unique<Batch>();
+	}
+	// full: the network thread is stuck, this tick's packets go with the next
+}
+
+void NetworkThread::printStats() {
+	inStats.print("in");
+}
@@ -0,0 +1,26 @@
+#include "PositionHistory.h"
+
+void PositionHistory::record(const GameState& state) {
+	Frame& frame = frames[state.tick % CAPACITY];
+	frame.tick = state.tick;
+	for (int i = 0; i < PLAYERS; i++) {
+		frame.pos[i][0] = state.players[i].x;
+		frame.pos[i][1] = state.players[i].y;
+		frame.pos[i][2] = state.players[i].z;
+	}
+}
+
+void PositionHistory::clear() {
+	for (Frame& frame : frames) {
+		frame.tick = UINT64_MAX;
+	}
+}
+
+bool PositionHistory::rewind(uint64_t tick, int id, PlayerState& player) const {
+	const Frame& frame = frames[tick % CAPACITY];
+	if (frame.tick != tick) return false;
+	player.x = frame.pos[id][0];
+	player.y = frame.pos[id][1];
+	player.z = frame.pos[id][2];
+	return true;
+}
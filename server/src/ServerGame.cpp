@@ -1,7 +1,10 @@
 ﻿#include <random>
 #include <vector>
+#include <bit>
 #include <iostream>
 #include <numeric>
+#include <filesystem>
+#include <cmath>
 #include "ServerGame.h"
 #include "Parson.h"
 
@@ -9,22 +12,23 @@
 using namespace std;
 unsigned int ServerGame::client_id;
 
-ServerGame::ServerGame(void) :
-	rng(dev()),
+ServerGame::ServerGame(bool headless, unsigned int seed) :
+	rngSeed(headless ? seed : dev()),
+	rng(rngSeed),
 	randomSpawnLocationGen(0, (unsigned int)NUM_SPAWNS - 1)
 {
 	client_id = 0;
-	network = new ServerNetwork();
+	network = headless ? nullptr : new NetworkThread(new ServerNetwork());
 	round_id = 0;
 
 	state = new GameState{
 		.tick = 0,
-		//x, y, z, yaw, pitch, zVelocity, speed, coins, isHunter, isDead, isGrounded, jumpCounts, availableJumps
+		//x, y, z, yaw, pitch, zVelocity, speed, coins, isHunter, isDead, isGrounded, isBear, isPhantom, jumpCounts, availableJumps, dodgeCollide, slowedFrom, slowedUntil, stunnedUntil, dodgingUntil
 		.players = {
-			{ 4.0f * PLAYER_SCALING_FACTOR,  4.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, HUNTER_INIT_SPEED, PLAYER_INIT_COINS, true, false, false, false, 1, 1 },
-			{-2.0f * PLAYER_SCALING_FACTOR,  2.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, PLAYER_INIT_SPEED, PLAYER_INIT_COINS, false, false, false, false, 1, 1 },
-			{ 2.0f * PLAYER_SCALING_FACTOR, -2.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, PLAYER_INIT_SPEED, PLAYER_INIT_COINS, false, false, false, false, 1, 1 },
-			{-2.0f * PLAYER_SCALING_FACTOR, -2.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, PLAYER_INIT_SPEED, PLAYER_INIT_COINS, false, false, false, false, 1, 1 },
+			{ 4.0f * PLAYER_SCALING_FACTOR,  4.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, HUNTER_INIT_SPEED, PLAYER_INIT_COINS, true, false, false, false, false, 1, 0, true, 0, 0, 0, 0 },
+			{-2.0f * PLAYER_SCALING_FACTOR,  2.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, PLAYER_INIT_SPEED, PLAYER_INIT_COINS, false, false, false, false, false, 1, 0, true, 0, 0, 0, 0 },
+			{ 2.0f * PLAYER_SCALING_FACTOR, -2.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, PLAYER_INIT_SPEED, PLAYER_INIT_COINS, false, false, false, false, false, 1, 0, true, 0, 0, 0, 0 },
+			{-2.0f * PLAYER_SCALING_FACTOR, -2.0f * PLAYER_SCALING_FACTOR, -200.0f * PLAYER_SCALING_FACTOR, 0.0f, 0.0f, 0.0f, PLAYER_INIT_SPEED, PLAYER_INIT_COINS, false, false, false, false, false, 1, 0, true, 0, 0, 0, 0 },
 		},
 		.timerFrac = 0.0f,
 	};
@@ -34,64 +38,89 @@ ServerGame::ServerGame(void) :
 		.gamePhase = GamePhase::START_MENU
 	};
 
-	timer = new Timer();
 	tiebreaker = false;
 	attackRange = ATTACK_DEFAULT_RANGE;
 	attackCooldownTicks = cdDefaultTicks;
 
-	//// each box → 6 floats: {min.x, min.y, min.z, max.x, max.y, max.z}
-	//vector<vector<float>> boxes2d;
-	//// colors2d[i][0..3] = R, G, B, A (0–255)
-	//vector<vector<int>> colors2d;
-
-
 	newGame();
 }
 
 void ServerGame::update() {
-	auto now = std::chrono::steady_clock::now();
-	if (now < next_tick) {
-		std::this_thread::sleep_for(next_tick - now);
+	// started here, not in the constructor, so the options set in between
+	// reach the network before its thread does
+	if (network && !network->started()) network->start();
+
+	uint32_t steps = scheduler.wait();
+	for (uint32_t i = 0; i < steps; i++) {
+		step();
 	}
-	else {
-		printf("[WARNING] Tick %llu time surpassed expected time\n", state->tick);
+
+	if (state->tick - lastStatsTick >= STATS_INTERVAL_TICKS) {
+		scheduler.printStats();
+		scheduler.resetStats();
+		if (snapshotsSent) {
+			printf("[SNAPSHOT] %llu sent, %llu keyframes, %.1f bytes each (%zu as a full GameState)\n",
+				(unsigned long long)snapshotsSent, (unsigned long long)snapshotKeyframes,
+				(double)snapshotBytes / snapshotsSent, HDR_SIZE + sizeof(GameState));
+			snapshotsSent = snapshotKeyframes = snapshotBytes = 0;
+		}
+		InputQueue::Stats input = inputStats();
+		for (auto& [id, queue] : inputs) {
+			queue.resetStats();
+		}
+		if (input.received) {
+			printf("[INPUT] %llu moves applied, %llu repeated for missing ones (%llu ticks starved); dropped %llu late, %llu duplicate, %llu to catch up\n",
+				(unsigned long long)input.applied, (unsigned long long)input.repeated, (unsigned long long)input.starved,
+				(unsigned long long)input.late, (unsigned long long)input.duplicates, (unsigned long long)input.dropped);
+		}
+		if (network) network->printStats();
+#if TICK_PROFILE
+		profiler.dump(PROFILE_FILE, TICK_BUDGET_NS);
+#endif
+		lastStatsTick = state->tick;
 	}
-	next_tick = std::chrono::steady_clock::now() + TICK_DURATION;
+}
+
+void ServerGame::setCatchUp(TickScheduler::CatchUp mode, uint32_t maxSteps) {
+	scheduler.configure(mode, maxSteps);
+}
+
+void ServerGame::step() {
+	PROFILE_SCOPE(profiler, TICK);
 	++state->tick;
 
-	if (network->acceptNewClient(client_id)) {
-		printf("client %d has connected to the server (tick %llu)\n", client_id, state->tick);
-		client_id++;
-	}
+	// expire everything due this tick before any input is applied
+	{ PROFILE_SCOPE(profiler, TIMERS); timers.advance(state->tick); }
 
-	receiveFromClients();
+	{ PROFILE_SCOPE(profiler, RECEIVE); receiveFromClients(); }
 
-	state_mu.lock();
 	switch (appState->gamePhase) {
 		case GamePhase::GAME_PHASE:
 		{
-			applyMovements();
-			applyCamera();
-			applyPhysics();
-			applyAttacks();
-			applyDodge();
-			applyInstinct();
-			sendGameStateUpdates();
-			handleGamePhase();
+			{ PROFILE_SCOPE(profiler, MOVEMENTS); applyMovements(); }
+			{ PROFILE_SCOPE(profiler, CAMERA); applyCamera(); }
+			{ PROFILE_SCOPE(profiler, PHYSICS); applyPhysics(); }
+			{ PROFILE_SCOPE(profiler, ATTACKS); applyAttacks(); }
+			{ PROFILE_SCOPE(profiler, INSTINCT); applyInstinct(); }
+			{ PROFILE_SCOPE(profiler, SEND_STATE); sendGameStateUpdates(); }
+			{ PROFILE_SCOPE(profiler, GAME_PHASE); handleGamePhase(); }
 			break;
 		}
 		case GamePhase::START_MENU:
 		{
+			PROFILE_SCOPE(profiler, MENU);
 			handleStartMenu();
 			break;
 		}
 		case GamePhase::SHOP_PHASE:
 		{
+			PROFILE_SCOPE(profiler, MENU);
 			handleShopPhase();
 			break;
 		}
 		case GamePhase::GAME_END:
 		{
+			PROFILE_SCOPE(profiler, MENU);
 			handleEndPhase();
 			break;
 		}
@@ -100,236 +129,325 @@ void ServerGame::update() {
 			break;
 		}
 	}
-	state_mu.unlock();
 
-	sendAnimationUpdates();
+	{ PROFILE_SCOPE(profiler, ANIMATIONS); sendAnimationUpdates(); }
+	// everything this tick sent goes to the network thread in one batch
+	if (network) { PROFILE_SCOPE(profiler, FLUSH); network->endTick(); }
+
+	if (recorder) recorder->endTick(*state);
+}
+
+bool ServerGame::startRecording(const wchar_t* fileAddr) {
+	InputRecorder* next = new InputRecorder();
+	if (!next->open(fileAddr, rngSeed)) {
+		delete next;
+		return false;
+	}
+	delete recorder;
+	recorder = next;
+	printf("[RECORD] logging input to %ls (seed %u)\n", fileAddr, rngSeed);
+	return true;
 }
 
 void ServerGame::receiveFromClients() 
 {
-	std::map<unsigned int, SOCKET>::iterator iter;
+	if (!network) {
+		// headless: the driver queued the packets instead of a socket
+		for (auto& [id, data] : headlessInbox) {
+			if (data.empty()) continue;
+			handlePackets(id, data.data(), (int)data.size());
+			data.clear();
+		}
+		return;
+	}
 
-	for (auto& [id, sock] : network->sessions) {
-		if (!NetworkServices::checkMessage(sock)) {
-			continue;
+	// everything the network thread read since the last tick, in order
+	NetworkThread::Event event;
+	while (network->nextEvent(event)) {
+		switch (event.kind) {
+		case NetworkThread::EventKind::CONNECTED:
+			printf("client %d has connected to the server (tick %llu)\n", event.id, state->tick);
+			clients.insert(event.id);
+			client_id = event.id + 1;
+			break;
+		case NetworkThread::EventKind::DISCONNECTED:
+			// its input queue stays: ids are never reused, and the queue runs
+			// dry on its own exactly as it does in a replay, which never sees
+			// the disconnect
+			clients.erase(event.id);
+			break;
+		case NetworkThread::EventKind::PACKET:
+			handlePackets(event.id, event.data, (int)event.length);
+			break;
 		}
-		int data_length = network->receiveData(id, network_data);
-		if (data_length <= 0) {
-			continue;
+	}
+}
+
+// Applies every packet in `data`, all received from client `id`
+void ServerGame::handlePackets(unsigned int id, char* data, int length)
+{
+	unsigned int i = 0;
+	while (i < (unsigned int)length) {
+		PacketHeader* hdr = (PacketHeader*) &(data[i]);
+		// acks only pick snapshot baselines, they never change the game
+		if (recorder && hdr->type != PacketType::SNAPSHOT_ACK) {
+			recorder->packet(state->tick, id, &data[i], min(hdr->len, (uint32_t)length - i));
 		}
 
-		unsigned int i = 0;
-		while (i < (unsigned int)data_length) {
-			PacketHeader* hdr = (PacketHeader*) &(network_data[i]);
+		switch (hdr->type) {
+		case PacketType::INIT_CONNECTION:
+		{
+			printf("[CLIENT %d] INIT\n", id);
+			char packet_data[HDR_SIZE + sizeof(IDPayload)];
 
-			switch (hdr->type) {
-			case PacketType::INIT_CONNECTION:
-			{
-				printf("[CLIENT %d] INIT\n", id);
-				char packet_data[HDR_SIZE + sizeof(IDPayload)];
-
-				NetworkServices::buildPacket<IDPayload>(PacketType::IDENTIFICATION, { id }, packet_data);
-
-				network->sendToClient(id, packet_data, HDR_SIZE + sizeof(IDPayload));
-
-				if (id != 4) {
-					state_mu.lock();
-					phaseStatus[id] = false;
-					state_mu.unlock();
-					state->players[id].x = playerSpawns[id].x;
-					state->players[id].y = playerSpawns[id].y;
-					state->players[id].z = playerSpawns[id].z;
-					state->players[id].yaw = startYaw;
-					state->players[id].pitch = startPitch;
-				}
-				else {
-					printf("[CLIENT %d] SPECTATOR INIT\n", id);
-				}
+			NetworkServices::buildPacket<IDPayload>(PacketType::IDENTIFICATION, { id }, packet_data);
 
-				sendGameStateUpdates();
+			sendToClient(id, packet_data, HDR_SIZE + sizeof(IDPayload));
 
-				break;
+			if (id != 4) {
+				phaseStatus[id] = false;
+				state->players[id].x = playerSpawns[id].x;
+				state->players[id].y = playerSpawns[id].y;
+				state->players[id].z = playerSpawns[id].z;
+				state->players[id].yaw = startYaw;
+				state->players[id].pitch = startPitch;
 			}
-			case PacketType::DEBUG:
-			{
-				DebugPayload* dbg = (DebugPayload*)&(network_data[i + HDR_SIZE]);
-				printf("[CLIENT %d] DEBUG: %s\n", id, dbg->message);
-				break;
-			}
-			case PacketType::MOVE:
-			{
-				MovePayload* mv = (MovePayload*)&(network_data[i + HDR_SIZE]);
-				// register the latest movement, but do not update yet
-				if ((id == 0 && state->tick > hunter_time)
-					|| (id != 0 && state->tick > runner_time))
-				{
-					//printf("[CLIENT %d] MOVE_PACKET: DIR (%f, %f, %f), PITCH %f, YAW %f, JUMP %d\n", id, mv->direction[0], mv->direction[1], mv->direction[2], mv->pitch, mv->yaw, mv->jump);
- 					latestMovement[id] = *mv;
-				}
-				break;
-			}
-			case PacketType::CAMERA:
-			{
-				CameraPayload* cam = (CameraPayload*)&(network_data[i+HDR_SIZE]);
-				// printf("[CLIENT %d] CAMERA_PACKET: PITCH %f, YAW %f\n", id, cam->pitch, cam->yaw);
-				latestCamera[id] = *cam;
-				break;
+			else {
+				printf("[CLIENT %d] SPECTATOR INIT\n", id);
 			}
-			case PacketType::ATTACK:
-			{
-				if (id != 0) break;                               // not the hunter
-				if (state->tick < hunterEndSlowdown) break;         // still in pipeline
-				
-				// animation state
-				animationState.curAnims[0] = HunterAnimation::HUNTER_ANIMATION_ATTACK;
-				animationState.isLoop[0] = false;
 
-				auto* atk = (AttackPayload*)&network_data[i + HDR_SIZE];
-				pendingSwing = DelayedAttack{ *atk, state->tick + windupTicks };
-				hunterStartSlowdown = state->tick + windupTicks; // start slowing down after windup
-				hunterEndSlowdown = hunterStartSlowdown + attackCooldownTicks;
+			sendGameStateUpdates();
 
-				printf("[HUNTER] swing queued (hit @ %llu, busy until %llu)\n",
-					pendingSwing->hitTick, hunterEndSlowdown);
-				break;
+			break;
+		}
+		case PacketType::SNAPSHOT_ACK:
+		{
+			SnapshotAckPayload* ack = (SnapshotAckPayload*)&(data[i + HDR_SIZE]);
+			uint32_t& acked = snapshotAcked[id];
+			// a stale ack would only make the deltas bigger
+			if (ack->sequence > acked && ack->sequence <= snapshotSequence) {
+				acked = ack->sequence;
 			}
-			case PacketType::DODGE:
+			break;
+		}
+		case PacketType::DEBUG:
+		{
+			DebugPayload* dbg = (DebugPayload*)&(data[i + HDR_SIZE]);
+			printf("[CLIENT %d] DEBUG: %s\n", id, dbg->message);
+			break;
+		}
+		case PacketType::MOVE:
+		{
+			// recordings from before MovePayload::sequence leave it 0
+			MovePayload mv{};
+			memcpy(&mv, &data[i + HDR_SIZE], min<size_t>(sizeof mv, hdr->len - HDR_SIZE));
+			// queue the movement, applyMovements takes one a tick
+			if (appState->gamePhase == GamePhase::GAME_PHASE
+				&& ((id == 0 && state->tick > hunter_time)
+				|| (id != 0 && state->tick > runner_time)))
 			{
-				// hunters and bear cannot dodge
-				if (state->players[id].isHunter || state->players[id].isDead || state->players[id].isBear) break;
-
-				bool offCooldown = (state->tick - lastDodgeTick[id]) >= dodgeCooldownTicks[id];
-				if (!offCooldown) break;                           // silently ignore spam
-
-				// grant!
-				animationState.curAnims[id] = RunnerAnimation::RUNNER_ANIMATION_DODGE;
-				animationState.isLoop[id] = false; 
-				lastDodgeTick[id] = state->tick;
-				invulTicks[id] = INVUL_TICKS;
-				dashTicks[id] = INVUL_TICKS;                   // dash lasts same 30 ticks
-
-				// speed boost
-				state->players[id].speed *= DASH_SPEED_MULTIPLIER;
-
-				// notify the client
-				sendActionOk(Actions::DODGE, 0, id, true, 0);
-
-				printf("[DODGE] survivor %u granted at tick %llu\n", id, state->tick);
-				break;
+				//printf("[CLIENT %d] MOVE_PACKET: DIR (%f, %f, %f), PITCH %f, YAW %f, JUMP %d\n", id, mv.direction[0], mv.direction[1], mv.direction[2], mv.pitch, mv.yaw, mv.jump);
+				inputs[id].push(mv);
+			}
+			else {
+				// too early or between rounds, but the client's prediction is caught up to here all the same
+				inputs[id].skip(mv.sequence);
 			}
+			break;
+		}
+		case PacketType::CAMERA:
+		{
+			CameraPayload* cam = (CameraPayload*)&(data[i+HDR_SIZE]);
+			// printf("[CLIENT %d] CAMERA_PACKET: PITCH %f, YAW %f\n", id, cam->pitch, cam->yaw);
+			latestCamera[id] = *cam;
+			break;
+		}
+		case PacketType::ATTACK:
+		{
+			if (id != 0) break;                               // not the hunter
+			if (timers.pending(hunterRecovery)) break;         // still in pipeline
+			
+			// animation state
+			animationState.curAnims[0] = HunterAnimation::HUNTER_ANIMATION_ATTACK;
+			animationState.isLoop[0] = false;
+
+			auto* atk = (AttackPayload*)&data[i + HDR_SIZE];
+			pendingSwing = DelayedAttack{ *atk, state->tick + windupTicks };
+			uint64_t slowdown = state->tick + windupTicks; // start slowing down after windup
+			hunterRecovery = timers.schedule(slowdown + attackCooldownTicks);
+			state->players[0].slowedFrom = (uint32_t)slowdown;
+			state->players[0].slowedUntil = (uint32_t)timers.deadline(hunterRecovery);
+
+			printf("[HUNTER] swing queued (hit @ %llu, busy until %llu)\n",
+				pendingSwing->hitTick, timers.deadline(hunterRecovery));
+			break;
+		}
+		case PacketType::DODGE:
+		{
+			// hunters and bear cannot dodge
+			if (state->players[id].isHunter || state->players[id].isDead || state->players[id].isBear) break;
+
+			bool offCooldown = !timers.pending(dodgeCooldownEnd[id]);
+			if (!offCooldown) break;                           // silently ignore spam
+
+			// grant!
+			animationState.curAnims[id] = RunnerAnimation::RUNNER_ANIMATION_DODGE;
+			animationState.isLoop[id] = false; 
+			// speed boost
+			state->players[id].speed *= DASH_SPEED_MULTIPLIER;
+
+			// invulnerable while dashing, then slowed until the cooldown ends
+			unsigned int survivor = id;
+			uint64_t dashOver = state->tick + INVUL_TICKS;
+			uint64_t cooldownOver = state->tick + (uint64_t)ceilf(dodgeCooldownTicks[id]);
+			invulEnd[id] = timers.schedule(dashOver);
+			state->players[id].dodgingUntil = (uint32_t)dashOver;
+			dashEnd[id] = timers.schedule(dashOver, [this, survivor]() {
+				// reset speed
+				state->players[survivor].speed /= DASH_SPEED_MULTIPLIER;
+
+				// players are slowed until end of cooldown
+				state->players[survivor].speed *= DASH_COOLDOWN_PENALTY;
+			});
+			dodgeCooldownEnd[id] = timers.schedule(max(cooldownOver, dashOver), [this, survivor]() {
+				state->players[survivor].speed /= DASH_COOLDOWN_PENALTY;
+
+				animationState.curAnims[survivor] = RunnerAnimation::RUNNER_ANIMATION_IDLE;
+				animationState.isLoop[survivor] = true;
+			});
+
+			// notify the client
+			sendActionOk(Actions::DODGE, 0, id, true, 0);
+
+			printf("[DODGE] survivor %u granted at tick %llu\n", id, state->tick);
+			break;
+		}
 
-			case PacketType::PLAYER_READY:
-			{
-				PlayerReadyPayload* status = (PlayerReadyPayload*)&(network_data[i + HDR_SIZE]);
-				printf("[CLIENT %d] PLAYER_READY_PACKET: READY=%d\n", id, status->ready);
+		case PacketType::PLAYER_READY:
+		{
+			PlayerReadyPayload* status = (PlayerReadyPayload*)&(data[i + HDR_SIZE]);
+			printf("[CLIENT %d] PLAYER_READY_PACKET: READY=%d\n", id, status->ready);
 
-				// Save powerup selections
-				if (appState->gamePhase == GamePhase::SHOP_PHASE)
+			// Save powerup selections
+			if (appState->gamePhase == GamePhase::SHOP_PHASE)
+			{
+				printf("Selection: %d\n", status->selection);
+				sendActionOk(Actions::SHOP_UPDATE, 0, id, true, 0);
+				// Only save if they selected a powerup
+				if (status->selection != 0) 
 				{
-					printf("Selection: %d\n", status->selection);
-					sendActionOk(Actions::SHOP_UPDATE, 0, id, true, 0);
-					// Only save if they selected a powerup
-					if (status->selection != 0) 
-					{
-						applyPowerups(id, status->selection);
-						state->players[id].coins -= PowerupInfo[(Powerup)status->selection].cost;
-					}
+					applyPowerups(id, status->selection);
+					state->players[id].coins -= PowerupInfo[(Powerup)status->selection].cost;
 				}
-				
-				state_mu.lock();
-				phaseStatus[id] = status->ready;
-				state_mu.unlock();
-
-				break;
 			}
-			case PacketType::BEAR:
-			{
-				// payload is empty
-				//BearPayload* bear = (BearPayload*)&(network_data[i + HDR_SIZE]);
-				printf("[CLIENT %d] BEAR_PACKET\n", id);
-
-				// drop if player doesn't have the powerup
-				if (!hasBear[id])
-					break;
-				
-				// check within range
-				if (state->players[id].x >= BEAR_POS.x - 0.3 &&
-					state->players[id].x <= BEAR_POS.x + 0.3 &&
-					state->players[id].y >= BEAR_POS.y - 0.3 &&
-					state->players[id].y <= BEAR_POS.y + 0.3)
-				{
-					// drop if anyone is bear
-					bool bearActive = false;
-					for (int i = 0; i < num_players; i++) {
-						bearActive = bearActive || state->players[i].isBear;
-					}
-					if (bearActive) break;
-					
-					state->players[id].isBear = true;
+			
+			phaseStatus[id] = status->ready;
 
-					bearTicks = state->tick + (BEAR_TICKS * hasBear[id]);
-					state->players[id].z += 5.0f * PLAYER_SCALING_FACTOR; // bear is taller
-					hasBear[id] = 0;
+			break;
+		}
+		case PacketType::BEAR:
+		{
+			// payload is empty
+			//BearPayload* bear = (BearPayload*)&(data[i + HDR_SIZE]);
+			printf("[CLIENT %d] BEAR_PACKET\n", id);
 
-					sendActionOk(Actions::BEAR, bearTicks, id, true, 0);
-					
-					printf("IT'S BEAR TIME!!!\n");
+			// drop if player doesn't have the powerup
+			if (!hasBear[id])
+				break;
+			
+			// check within range
+			if (state->players[id].x >= BEAR_POS.x - 0.3 &&
+				state->players[id].x <= BEAR_POS.x + 0.3 &&
+				state->players[id].y >= BEAR_POS.y - 0.3 &&
+				state->players[id].y <= BEAR_POS.y + 0.3)
+			{
+				// drop if anyone is bear
+				bool bearActive = false;
+				for (int i = 0; i < num_players; i++) {
+					bearActive = bearActive || state->players[i].isBear;
 				}
+				if (bearActive) break;
+				
+				state->players[id].isBear = true;
+
+				bearTicks = state->tick + (BEAR_TICKS * hasBear[id]);
+				unsigned int bear = id;
+				timers.cancel(bearEnd);
+				bearEnd = timers.schedule(bearTicks, [this, bear]() {
+					// bear power runs out
+					state->players[bear].isBear = false;
+				});
+				state->players[id].z += 5.0f * PLAYER_SCALING_FACTOR; // bear is taller
+				hasBear[id] = 0;
+
+				sendActionOk(Actions::BEAR, bearTicks, id, true, 0);
+				
+				printf("IT'S BEAR TIME!!!\n");
+			}
 
 
+			break;
+		}
+		case PacketType::PHANTOM:
+		{
+			// payload is empty
+			//PhantomPayload* phantom = (PhantomPayload*)&(data[i + HDR_SIZE]);
+			printf("[CLIENT %d] PHANTOM_PACKET\n", id);
+			// drop if player doesn't have the powerup
+			if (!hasPhantom)
 				break;
-			}
-			case PacketType::PHANTOM:
-			{
-				// payload is empty
-				//PhantomPayload* phantom = (PhantomPayload*)&(network_data[i + HDR_SIZE]);
-				printf("[CLIENT %d] PHANTOM_PACKET\n", id);
-				// drop if player doesn't have the powerup
-				if (!hasPhantom)
-					break;
-				// drop if phantom is already active
-				if (state->players[id].isPhantom)
-					break;
-				else 
-				{
-					state->players[id].isPhantom = true;
-					phantomTicks = state->tick + (PHANTOM_TICKS * hasPhantom);
-					hasPhantom = 0; // reset phantom powerup
-					sendActionOk(Actions::PHANTOM, phantomTicks, id, true, 0);
-					printf("IT'S PHANTOM TIME!!!\n");
-				}
+			// drop if phantom is already active
+			if (state->players[id].isPhantom)
 				break;
-			}
-			case PacketType::NOCTURNAL:
+			else 
 			{
-				// payload is empty
-				//PhantomPayload* phantom = (PhantomPayload*)&(network_data[i + HDR_SIZE]);
-				printf("[CLIENT %d] NOCTURNAL_PACKET\n", id);
-				// drop if player doesn't have the powerup
-				if (!state->players[id].isHunter || !hasNocturnal)
-					break;
-				// drop if nocturnal is already active
-				if (isNocturnal)
-					break;
-				else 
-				{
-					isNocturnal = true;
-					nocturnalTicks = state->tick + (NOCTURNAL_TICKS * hasNocturnal);
-					hasNocturnal = 0; // reset nocturnal powerup
-					sendActionOk(Actions::NOCTURNAL, nocturnalTicks, id, true, 0);
-					printf("IT'S NOCTURNAL TIME!!!\n");
-				}
-				break;
+				state->players[id].isPhantom = true;
+				phantomTicks = state->tick + (PHANTOM_TICKS * hasPhantom);
+				timers.cancel(phantomEnd);
+				phantomEnd = timers.schedule(phantomTicks, [this]() {
+					// phantom power runs out
+					for (int p = 0; p < num_players; p++) {
+						state->players[p].isPhantom = false;
+					}
+				});
+				hasPhantom = 0; // reset phantom powerup
+				sendActionOk(Actions::PHANTOM, phantomTicks, id, true, 0);
+				printf("IT'S PHANTOM TIME!!!\n");
 			}
-			default:
-				printf("[CLIENT %d] ERR: Packet type %d\n", id, hdr->type);
+			break;
+		}
+		case PacketType::NOCTURNAL:
+		{
+			// payload is empty
+			//PhantomPayload* phantom = (PhantomPayload*)&(data[i + HDR_SIZE]);
+			printf("[CLIENT %d] NOCTURNAL_PACKET\n", id);
+			// drop if player doesn't have the powerup
+			if (!state->players[id].isHunter || !hasNocturnal)
+				break;
+			// drop if nocturnal is already active
+			if (isNocturnal)
 				break;
+			else 
+			{
+				isNocturnal = true;
+				nocturnalTicks = state->tick + (NOCTURNAL_TICKS * hasNocturnal);
+				timers.cancel(nocturnalEnd);
+				nocturnalEnd = timers.schedule(nocturnalTicks, [this]() {
+					isNocturnal = false;
+				});
+				hasNocturnal = 0; // reset nocturnal powerup
+				sendActionOk(Actions::NOCTURNAL, nocturnalTicks, id, true, 0);
+				printf("IT'S NOCTURNAL TIME!!!\n");
 			}
-
-			i += hdr->len; // move to next packet in buffer
+			break;
+		}
+		default:
+			printf("[CLIENT %d] ERR: Packet type %d\n", id, hdr->type);
+			break;
 		}
-	}
 
+		i += hdr->len; // move to next packet in buffer
+	}
 }
 
 
@@ -337,6 +455,7 @@ void ServerGame::receiveFromClients()
 // int seconds: length of round
 void ServerGame::startARound(int seconds) {
 	round_id++;
+	roundsStarted++;
 	sendPlayerPowerups();
 	isNocturnal = false;
 	for (unsigned int id = 0; id < num_players; ++id) {
@@ -367,75 +486,84 @@ void ServerGame::startARound(int seconds) {
 		player.isDead = false;
 		player.isBear = false;
 		player.isPhantom = false;
+		// a stun from the end of the last round does not carry over
+		player.stunnedUntil = 0;
 		// print player coin
 		printf("[round %d] Player %d coins: %d\n", round_id, id, player.coins);
 	}
+	// input sent before the respawn would move the players from the wrong place
+	for (auto& [id, queue] : inputs) {
+		queue.clear();
+	}
+	// and no swing may see them where they were last round
+	positionHistory.clear();
+	viewTicks.fill(0);
 	int start_tick = state->tick;
 	runner_time = start_tick + (RUNNER_SPAWN_PERIOD * TICKS_PER_SEC);
 	hunter_time = start_tick + (HUNTER_SPAWN_PERIOD * TICKS_PER_SEC);
 
-	timer->startTimer(seconds, [this]() {
-		// This code runs after the timer completes
-		
-		state_mu.lock();
+	printf("[TIMER] round %d ends in %d seconds\n", round_id, seconds);
+	roundStartTick = state->tick;
+	roundEndTick = state->tick + (uint64_t)seconds * TICKS_PER_SEC;
+	timers.cancel(roundEnd);
+	roundEnd = timers.schedule(roundEndTick, [this]() { endRound(); });
+}
 
-		// set all status to true here, handle in the main game loop
-		for (auto& [id, status] : phaseStatus) {
-			status = true;
-		}
+// Ends the running round: scores it and marks everyone ready so
+// handleGamePhase moves on to the next phase
+void ServerGame::endRound() {
+	// set all status to true here, handle in the main game loop
+	for (auto& [id, status] : phaseStatus) {
+		status = true;
+	}
 
-		// Count how many survivors survived the round
-		unsigned int num_survivors = 0;
-		unsigned int hunter_id = 0;
-		for (unsigned int id = 0; id < num_players; ++id) {
-			if (!state->players[id].isDead && !state->players[id].isHunter) {
-				num_survivors++;
-			}
-			if (state->players[id].isHunter) {
-				hunter_id = id; // save hunter id
-			}
-		}
-		// Determine who wins this round
-		if (num_survivors == 0) {
-			printf("[round %d] No survivors survived the round, hunter wins!\n", round_id);
+	// Count how many survivors survived the round
+	unsigned int num_survivors = 0;
+	unsigned int hunter_id = 0;
+	for (unsigned int id = 0; id < num_players; ++id) {
+		if (!state->players[id].isDead && !state->players[id].isHunter) {
+			num_survivors++;
 		}
-		else {
-			printf("[round %d] %d survivors survived the round!\n", round_id, num_survivors);
+		if (state->players[id].isHunter) {
+			hunter_id = id; // save hunter id
 		}
+	}
+	// Determine who wins this round
+	if (num_survivors == 0) {
+		printf("[round %d] No survivors survived the round, hunter wins!\n", round_id);
+	}
+	else {
+		printf("[round %d] %d survivors survived the round!\n", round_id, num_survivors);
+	}
 
-		// Add points to survivors and hunter
-		runner_points += num_survivors;
-		hunter_points += 3 - num_survivors; // hunter gets 1 points for each survivor dead
-		printf("[round %d] Runner points: %d, Hunter points: %d\n", round_id, runner_points, hunter_points);
+	// Add points to survivors and hunter
+	runner_points += num_survivors;
+	hunter_points += 3 - num_survivors; // hunter gets 1 points for each survivor dead
+	printf("[round %d] Runner points: %d, Hunter points: %d\n", round_id, runner_points, hunter_points);
 
-		// Survivors each get ${3-sum_survivors} coins, Hunter gets ${sum_survivors}.
-		for (unsigned int id = 0; id < num_players; ++id) {
-			if (!state->players[id].isHunter) {
-				state->players[id].coins += 4 - num_survivors;
-				printf("[round %d] Player %d coins: %d\n", round_id, id, state->players[id].coins);
-			}
-			else {
-				state->players[id].coins += num_survivors + 1; // hunter gets more coins if more survivors are alive
-				//printf("adding %d coins to hunter %d\n", 3 - num_survivors, id);
-				printf("[round %d] Hunter %d coins: %d\n", round_id, id, state->players[id].coins);
-			}
+	// Survivors each get ${3-sum_survivors} coins, Hunter gets ${sum_survivors}.
+	for (unsigned int id = 0; id < num_players; ++id) {
+		if (!state->players[id].isHunter) {
+			state->players[id].coins += 4 - num_survivors;
+			printf("[round %d] Player %d coins: %d\n", round_id, id, state->players[id].coins);
 		}
-		// check if it is a tiebreaker round
-		if (tiebreaker) {
-			// the points will never be the same for both teams.
-			if (runner_points > hunter_points) {
-				printf("[round %d] Tiebreaker round ended, survivors win!\n", round_id);
-			}
-			else {
-				printf("[round %d] Tiebreaker round ended, hunter wins!\n", round_id);
-			}
-			tiebreaker = false; // reset tiebreaker
+		else {
+			state->players[id].coins += num_survivors + 1; // hunter gets more coins if more survivors are alive
+			//printf("adding %d coins to hunter %d\n", 3 - num_survivors, id);
+			printf("[round %d] Hunter %d coins: %d\n", round_id, id, state->players[id].coins);
+		}
+	}
+	// check if it is a tiebreaker round
+	if (tiebreaker) {
+		// the points will never be the same for both teams.
+		if (runner_points > hunter_points) {
+			printf("[round %d] Tiebreaker round ended, survivors win!\n", round_id);
+		}
+		else {
+			printf("[round %d] Tiebreaker round ended, hunter wins!\n", round_id);
 		}
-		// Don't send packets in timer!
-		// Socket wrapper isn't thread safe...
-		// sendAppPhaseUpdates();
-		state_mu.unlock();
-	});
+		tiebreaker = false; // reset tiebreaker
+	}
 }
 
 void ServerGame::handleStartMenu() {
@@ -473,6 +601,14 @@ void ServerGame::newGame()
 	prevInstinctTickEnd = 0;
 	hasInstinct = false;
 	isNocturnal = false;
+	// drop leftover powerup and dodge timers, speeds are reset below
+	timers.clear();
+	for (int i = 0; i < num_players; i++) {
+		state->players[i].slowedFrom = 0;
+		state->players[i].slowedUntil = 0;
+		state->players[i].stunnedUntil = 0;
+		state->players[i].dodgingUntil = 0;
+	}
 
 	for (int i = 0; i < num_players; i++) {
 		state->players[i].coins = PLAYER_INIT_COINS;
@@ -543,7 +679,9 @@ bool ServerGame::anyWinners() {
 // -----------------------------------------------------------------------------
 
 void ServerGame::handleGamePhase() {
-	state->timerFrac = timer->getFracElapsed();
+	state->timerFrac = (roundEndTick > roundStartTick)
+		? min(1.0f, (float)(state->tick - roundStartTick) / (float)(roundEndTick - roundStartTick))
+		: 0.0f;
 	bool ready = true;
 	for (auto& [id, status] : phaseStatus) {
 		if (!status) {
@@ -564,6 +702,7 @@ void ServerGame::handleGamePhase() {
 				printf("[round %d] Game over! Winners: %s\n", round_id, (runner_points >= WIN_THRESHOLD) ? "runners" : "hunter");
 				appState->gamePhase = GamePhase::GAME_END;
 				appState->winners = (runner_points >= WIN_THRESHOLD) ? 2 : 1;
+				gamesFinished++;
 				sendAppPhaseUpdates();
 			}
 		}
@@ -698,17 +837,19 @@ void ServerGame::applyMovements() {
 		auto& player = state->players[id];
 		// printf("[CLIENT %d] isGrounded=%d z=%f zVelocity=%f\n", id, player.isGrounded ? 1 : 0, player.z, player.zVelocity);
 
-		// check if bear power runs out
-		if (player.isBear && bearTicks <= state->tick)
-		{
-			player.isBear = false;
-		}
+		// clients send a MOVE every tick they play, an idle one is no input to the animations
+		bool connected = network ? clients.count(id) > 0 : headlessInbox.count(id) > 0;
+		bool spawned = (int64_t)state->tick > (id == 0 ? hunter_time : runner_time);
+		const MovePayload* input = inputs[id].next(connected && spawned && !player.isDead);
+		if (input) viewTicks[id] = input->viewTick;
+		bool moving = input && (input->direction[0] != 0 ||
+			input->direction[1] != 0 || input->direction[2] != 0 || input->jump);
 
 		// reset to idle ONLY FROM MOVEMENT if no input
-		if (!latestMovement.count(id)) {
+		if (!moving) {
 			if (id == 0) {
 				bool wasChasing = (animationState.curAnims[id] == HunterAnimation::HUNTER_ANIMATION_CHASE);
-				bool canLeaveAttack = (state->tick >= hunterEndSlowdown);
+				bool canLeaveAttack = !timers.pending(hunterRecovery);
 				if ((wasChasing || canLeaveAttack) && lastAnimationState[id]) {
 					// reset animation back to idle only if it was previouslly moving
 					lastAnimationTime[id] = state->tick;
@@ -734,18 +875,11 @@ void ServerGame::applyMovements() {
 			lastAnimationState[id] = false;
 		}
 
-		// check if phantom power runs out
-		if (player.isPhantom && phantomTicks <= state->tick)
-		{
-			player.isPhantom = false;
-		}
-
-		float dx = 0, dy = 0, dz = 0;
-		if (latestMovement.count(id)) {
+		if (moving) {
 			// set movement ONLY IF at idle or attack is finished
 			if (id == 0) {
 				bool wasIdle = (animationState.curAnims[id] == HunterAnimation::HUNTER_ANIMATION_IDLE);
-				bool canLeaveAttack = (state->tick >= hunterEndSlowdown);
+				bool canLeaveAttack = !timers.pending(hunterRecovery);
 				if (wasIdle || canLeaveAttack)
 				{
 					animationState.curAnims[0] = HunterAnimation::HUNTER_ANIMATION_CHASE;
@@ -760,83 +894,29 @@ void ServerGame::applyMovements() {
 			}
 
 			lastAnimationState[id] = true;
-
-			auto& mv = latestMovement[id];
-			// update direction regardless of collision
-			player.yaw = mv.yaw;
-			player.pitch = mv.pitch;
-
-			// normalize the direction vector
-			float magnitude = sqrt(powf(mv.direction[0], 2) + powf(mv.direction[1], 2) + powf(mv.direction[2], 2));
-			if (magnitude != 0)
-				for (int i = 0; i < 3; i++)
-					mv.direction[i] /= magnitude;
-
-			// convert intent + yaw into 2d vector
-			// CLOCKWISE positive
-			// foward x/y, actual delta x/y
-			float fx = -sinf(mv.yaw), fy = cosf(mv.yaw), fz = 1;
-
-			dx = ((fx * mv.direction[0]) + (fy * mv.direction[1])) * player.speed;
-
-			dy = ((fy * mv.direction[0]) - (fx * mv.direction[1])) * player.speed;
-
-			dz = mv.direction[2] * player.speed; // vertical movement, if any
 		}
 
-		/* physics logic embedded */
-		/*bool wasGrounded = player.isGrounded;
-		player.isGrounded = false;
-
-		if (latestMovement.count(id) && latestMovement[id].jump && wasGrounded == true) {
-			player.zVelocity = JUMP_VELOCITY + extraJumpPowerup[id];
-			if (player.isBear) {
-				player.zVelocity += BEAR_JUMP_BOOST;
-			}
-			printf("[CLIENT %d] Jump registered. zVelocity=%f\n", id, state->players[id].zVelocity);
-		}*/
-		if (latestMovement.count(id) && latestMovement[id].jump) {
+		if (input && input->jump) {
 			printf("[CLIENT %d] Jump requested. availableJumps=%d\n", id, player.availableJumps);
 		}
-		if (latestMovement.count(id) && latestMovement[id].jump && player.availableJumps > 0 && player.zVelocity <= 0) {
-			//printf("[CLIENT %d] Jump requested. availableJumps=%d\n", id, player.availableJumps);
-			player.zVelocity += JUMP_VELOCITY + extraJumpPowerup[id];
-			player.availableJumps--;
-			if (player.isBear) {
-				player.zVelocity += BEAR_JUMP_BOOST;
-			}
-			printf("[CLIENT %d] Jump registered. zVelocity=%f\n", id, state->players[id].zVelocity);
-			sendActionOk(Actions::JUMP, 0, id, true, 0);
-		}
 
-		// gravity
-		if (player.isHunter && player.isPhantom) {
-			player.zVelocity = dz;
-		}
-		else {
-			player.zVelocity -= GRAVITY;
-			if (player.zVelocity < TERMINAL_VELOCITY)
-				player.zVelocity = TERMINAL_VELOCITY;
-		}
+		// from the windows in the state, as the client predicts them
+		PlayerMovement::Modifiers modifiers = PlayerMovement::modifiersAt(player, state->tick, extraJumpPowerup[id]);
+		PlayerMovement::Result moved = movement.step(state->players, num_players, id, input, modifiers);
 
-		// apply speed modifiers here:
-		// hunter slow debuff
-		if (player.isHunter && state->tick >= hunterStartSlowdown && state->tick < hunterEndSlowdown) {
-			dx *= hunterSlowFactor;
-			dy *= hunterSlowFactor;
-			// printf("[HUNTER] hunter %d is now slowed down\n", id);
+		if (moved.jumped) {
+			printf("[CLIENT %d] Jump registered. zVelocity=%f\n", id, player.zVelocity);
+			sendActionOk(Actions::JUMP, 0, id, true, 0);
 		}
-
-		if (player.isBear)
-		{
-			dx *= BEAR_SPEED_MULTIPLIER;
-			dy *= BEAR_SPEED_MULTIPLIER;
+		// if bear collides with hunter, hunter is stunned
+		if (moved.bearImpact) {
+			state->players[0].stunnedUntil = (uint32_t)(state->tick + BEAR_STUN_TIME);
+			sendActionOk(Actions::BEAR_IMPACT, 0, id, true, 0);
+			printf("HUNTER STUNNED\n");
 		}
-
-		updateClientPositionWithCollision(id, dx, dy, player.zVelocity);
 	}
 
-	latestMovement.clear(); // consume the movement, don't keep for next tick
+	positionHistory.record(*state);
 }
 
 void ServerGame::applyCamera() {
@@ -878,27 +958,36 @@ void ServerGame::applyAttacks()
 		pendingSwing->attack.yaw = state->players[0].yaw;
 		// leave range unchanged
 		
+		// the runners where the hunter saw them when they made this move
+		uint64_t seen = seenTick(0);
 
+		swingTargets.clear();
 		for (unsigned victimId = 1; victimId < 4; ++victimId)      // only survivors
 		{
 			// if (victimId == attackerId) continue;	// skip self
 			if (state->players[victimId].isDead) continue;	// skip dead players
-			if (state->players[victimId].isBear || hunterBearStunTicks > state->tick) continue;	// skip bear players or while stunned
-			if (invulTicks[victimId] > 0) continue;	// skip invulnerable players
+			if (state->players[victimId].isBear || state->tick < state->players[0].stunnedUntil) continue;	// skip bear players or while stunned
+			if (timers.pending(invulEnd[victimId])) continue;	// skip invulnerable players
 
-			if (isHit_(pendingSwing->attack, state->players[victimId]))
-			{
-				state->players[victimId].isDead = true;
+			PlayerState victim = state->players[victimId];
+			positionHistory.rewind(seen, victimId, victim);
+			swingVictims[swingTargets.count] = (uint8_t)victimId;
+			swingTargets.push(victim.x, victim.y, victim.z);
+		}
 
-				/* notify victim */
-				HitPayload hp{ 0u, victimId };
-				char buf[HDR_SIZE + sizeof hp];
-				NetworkServices::buildPacket(PacketType::HIT, hp, buf);
-				network->sendToClient(victimId, buf, sizeof buf);
+		uint64_t hits = swingHitMask(Swing::from(pendingSwing->attack, attackRange), swingTargets);
+		if (hits)
+		{
+			uint8_t victimId = swingVictims[countr_zero(hits)];   // one hit per swing, the lowest id
+			state->players[victimId].isDead = true;
 
-				printf("[HIT] hunter hits runner %u  (tick %llu)\n", victimId, state->tick);
-				break;                                           // one hit per swing
-			}
+			/* notify victim */
+			HitPayload hp{ 0u, victimId };
+			char buf[HDR_SIZE + sizeof hp];
+			NetworkServices::buildPacket(PacketType::HIT, hp, buf);
+			sendToClient(victimId, buf, sizeof buf);
+
+			printf("[HIT] hunter hits runner %u  (tick %llu, as seen at %llu)\n", victimId, state->tick, seen);
 		}
 		pendingSwing.reset();   // swing consumed
 
@@ -915,33 +1004,12 @@ void ServerGame::applyAttacks()
 
 	if (allDead) { 
 		printf("[GAME] all survivors dead\n"); 
-		timer->cancelTimer(); 
-}
-}
-
-void ServerGame::applyDodge()
-{
-	for (int i = 1; i < 4; i++) {
-		int8_t prevDashTick = dashTicks[i];
-		if (invulTicks[i] > 0) invulTicks[i]--;
-		if (dashTicks[i] > 0) dashTicks[i]--;
-		if (dashTicks[i] == 0 && prevDashTick > 0)
-		{
-			// reset speed
-			state->players[i].speed /= DASH_SPEED_MULTIPLIER;
-
-			// players are slowed until end of cooldown
-			state->players[i].speed *= DASH_COOLDOWN_PENALTY;
-		}
-		else if (dashTicks[i] == 0 && (state->tick - lastDodgeTick[i]) >= dodgeCooldownTicks[i]) {
-			// end of cooldown
-			dashTicks[i] = -1; // prevents from happening multiple times
-			state->players[i].speed /= DASH_COOLDOWN_PENALTY;
-
-			animationState.curAnims[i] = RunnerAnimation::RUNNER_ANIMATION_IDLE;
-			animationState.isLoop[i] = true;
+		// end the round now instead of waiting for the timer
+		if (timers.cancel(roundEnd)) {
+			roundEndTick = roundStartTick;
+			endRound();
 		}
-	}
+}
 }
 
 void ServerGame::applyInstinct() {
@@ -959,21 +1027,84 @@ void ServerGame::applyInstinct() {
 // NETWORK
 // -----------------------------------------------------------------------------
 
+// headless servers have no network, everything sent is dropped
+void ServerGame::sendToAll(char* packets, int totalSize) {
+	if (network) network->sendToAll(packets, totalSize);
+}
+
+void ServerGame::sendToClient(unsigned int id, char* packets, int totalSize) {
+	if (network) network->sendToClient(id, packets, totalSize);
+}
+
+void ServerGame::simulateLoss(const LossSimulator& loss) {
+	if (network) network->simulateLoss(loss);
+}
+
+unsigned int ServerGame::connectHeadless() {
+	unsigned int id = client_id++;
+	headlessInbox[id];
+	return id;
+}
+
+InputQueue::Stats ServerGame::inputStats() const {
+	InputQueue::Stats total;
+	for (auto& [id, queue] : inputs) {
+		// a slot nobody plays in only ever starves
+		if (queue.stats().received) total.add(queue.stats());
+	}
+	return total;
+}
+
+void ServerGame::queuePacket(unsigned int id, const char* data, int length) {
+	auto& inbox = headlessInbox[id];
+	inbox.insert(inbox.end(), data, data + length);
+}
+
 void ServerGame::sendAnimationUpdates() {
 	char packet_data[HDR_SIZE + sizeof(AnimationState)];
 
 	NetworkServices::buildPacket<AnimationState>(PacketType::ANIMATION_STATE, animationState, packet_data);
 
-	network->sendToAll(packet_data, HDR_SIZE + sizeof(AnimationState));
+	sendToAll(packet_data, HDR_SIZE + sizeof(AnimationState));
 }
 
+// Sends each client the state as a delta against the last snapshot it acked,
+// or as a keyframe before its first ack and once that baseline is too old
 void ServerGame::sendGameStateUpdates() {
+	if (!network) return;
+
+	if (rawState) {
+		// the GameState, then the client's input sequence as in a snapshot
+		char packet_data[HDR_SIZE + sizeof(GameState) + sizeof(uint32_t)];
+		PacketHeader* hdr = (PacketHeader*)packet_data;
+		hdr->type = PacketType::GAME_STATE;
+		hdr->len = (uint32_t)sizeof packet_data;
+		memcpy(packet_data + HDR_SIZE, state, sizeof(GameState));
+		for (unsigned int id : clients) {
+			uint32_t acked = inputs[id].acked();
+			memcpy(packet_data + HDR_SIZE + sizeof(GameState), &acked, sizeof acked);
+			sendToClient(id, packet_data, (int)sizeof packet_data);
+		}
+		return;
+	}
+
+	snapshotHistory.push(++snapshotSequence, *state);
 
-	char packet_data[HDR_SIZE + sizeof(GameState)];
+	char packet_data[HDR_SIZE + Snapshot::MAX_SIZE];
+	for (unsigned int id : clients) {
+		uint32_t acked = snapshotAcked[id];
+		const GameState* base = snapshotHistory.find(acked);
+		size_t size = Snapshot::encode(*state, snapshotSequence, base, acked, inputs[id].acked(), (uint8_t*)packet_data + HDR_SIZE);
 
-	NetworkServices::buildPacket<GameState>(PacketType::GAME_STATE, *state, packet_data);
+		PacketHeader* hdr = (PacketHeader*)packet_data;
+		hdr->type = PacketType::SNAPSHOT;
+		hdr->len = (uint32_t)(HDR_SIZE + size);
+		sendToClient(id, packet_data, (int)hdr->len);
 
-	network->sendToAll(packet_data, HDR_SIZE + sizeof(GameState));
+		snapshotsSent++;
+		snapshotKeyframes += base ? 0 : 1;
+		snapshotBytes += hdr->len;
+	}
 }
 
 void ServerGame::sendPlayerPowerups() {
@@ -1012,7 +1143,7 @@ void ServerGame::sendPlayerPowerups() {
 	}
 	NetworkServices::buildPacket<PlayerPowerupPayload>(PacketType::PLAYER_POWERUPS, data, packet_data);
 
-	network->sendToAll(packet_data, HDR_SIZE + sizeof(PlayerPowerupPayload));
+	sendToAll(packet_data, HDR_SIZE + sizeof(PlayerPowerupPayload));
 }
 
 void ServerGame::sendAppPhaseUpdates() {
@@ -1028,7 +1159,7 @@ void ServerGame::sendAppPhaseUpdates() {
 
 	NetworkServices::buildPacket<AppPhasePayload>(PacketType::APP_PHASE, *data, packet_data);
 
-	network->sendToAll(packet_data, HDR_SIZE + sizeof(AppPhasePayload));
+	sendToAll(packet_data, HDR_SIZE + sizeof(AppPhasePayload));
 }
 
 void ServerGame::sendShopOptions(ShopOptionsPayload* data) {
@@ -1036,7 +1167,7 @@ void ServerGame::sendShopOptions(ShopOptionsPayload* data) {
 
 	NetworkServices::buildPacket<ShopOptionsPayload>(PacketType::SHOP_INIT, *data, packet_data);
 
-	network->sendToAll(packet_data, HDR_SIZE + sizeof(ShopOptionsPayload));
+	sendToAll(packet_data, HDR_SIZE + sizeof(ShopOptionsPayload));
 }
 
 void ServerGame::sendInstinctUpdate(uint64_t nextInstinctEnd) {
@@ -1048,7 +1179,7 @@ void ServerGame::sendInstinctUpdate(uint64_t nextInstinctEnd) {
 
 	NetworkServices::buildPacket<InstinctPayload>(PacketType::INSTINCT, *data, packet_data);
 
-	network->sendToAll(packet_data, HDR_SIZE + sizeof(InstinctPayload));
+	sendToAll(packet_data, HDR_SIZE + sizeof(InstinctPayload));
 }
 
 // source: trigger id of action
@@ -1060,11 +1191,11 @@ void ServerGame::sendActionOk(Actions type, int ticks, int source, bool all, int
 	NetworkServices::buildPacket(PacketType::ACTION_OK, ok, buf);
 
 	if (!all) {
-		network->sendToClient(id, buf, sizeof buf);
+		sendToClient(id, buf, sizeof buf);
 
 	}
 	else {
-		network->sendToAll(buf, sizeof buf);
+		sendToAll(buf, sizeof buf);
 	}
 }
 
@@ -1072,271 +1203,47 @@ void ServerGame::sendActionOk(Actions type, int ticks, int source, bool all, int
 // PHYSICS
 // -----------------------------------------------------------------------------
 
-void ServerGame::updateClientPositionWithCollision(unsigned int clientId, float dx, float dy, float dz) {
-	// Update the position with collision detection
-	float delta[3] = { dx, dy, dz };
-
-	// Bounding box for the current client
-	float playerRadius = 1.0f * PLAYER_SCALING_FACTOR;
-	if (state->players[clientId].isBear) {
-		playerRadius = BEAR_HITBOX;
-	}
-
-	// Bounding box before player moves
-	BoundingBox staticPlayerBox = {
-			state->players[clientId].x - playerRadius,
-			state->players[clientId].y - playerRadius,
-			state->players[clientId].z - playerRadius,
-			state->players[clientId].x + playerRadius,
-			state->players[clientId].y + playerRadius,
-			state->players[clientId].z + playerRadius
-	};
-
-	for (int i = 0; i < 3; i++) {
-		bool isColliding = false;
-
-		BoundingBox playerBox = {
-			state->players[clientId].x - playerRadius,
-			state->players[clientId].y - playerRadius,
-			state->players[clientId].z - playerRadius,
-			state->players[clientId].x + playerRadius,
-			state->players[clientId].y + playerRadius,
-			state->players[clientId].z + playerRadius
-		};
-
-		if (i == 0) {
-			playerBox.minX += delta[0];
-			playerBox.maxX += delta[0];
-		}
-		else if (i == 1) {
-			playerBox.minY += delta[1];
-			playerBox.maxY += delta[1];
-		}
-		else if (i == 2) {
-			playerBox.minZ += delta[2];
-			playerBox.maxZ += delta[2];
-		}
-
-		// Check for collisions against other players
-		for (int c = 0; c < num_players; c++) {
-			// skip current client
-			if (c == (int)clientId) {
-				continue;
-			}
-
-			BoundingBox otherClientBox = {
-				state->players[c].x - playerRadius,
-				state->players[c].y - playerRadius,
-				state->players[c].z - playerRadius,
-				state->players[c].x + playerRadius,
-				state->players[c].y + playerRadius,
-				state->players[c].z + playerRadius,
-			};
-
-			if (checkCollision(playerBox, otherClientBox)) {
-				// printf("[CLIENT %d] Collision detected with client %d, axis=%d\n", clientId, c, i);
-
-				float distance = findDistance(staticPlayerBox, otherClientBox, i) * (delta[i] > 0 ? 1 : -1);
-				if (abs(distance) < abs(delta[i])) delta[i] = distance;
-
-				// If the z is being changed, reset z velocity and "ground" player
-				if (i == 2) {
-					// Check with zVelocity, not dz
-					if (state->players[clientId].zVelocity < 0) state->players[clientId].isGrounded = true;
-					state->players[clientId].zVelocity = 0;
-					// printf("[CLIENT %d] Collision with player detected. isGrounded=%d, zVelocity=%f\n", clientId, state->players[clientId].isGrounded ? 1 : 0, state->players[clientId].zVelocity);
-				}
-
-				// if bear collides with hunter, hunter is stunned
-				if (state->players[clientId].isBear && state->players[c].isHunter) {
-					hunterBearStunTicks = state->tick + BEAR_STUN_TIME;
-					state->players[clientId].isBear = false;
-					sendActionOk(Actions::BEAR_IMPACT, 0, clientId, true, 0);
-					printf("HUNTER STUNNED\n");
-				}
-			}
-		}
-
-		// check for bounding box collisions
-		for (size_t b = 0; b < boxes2d.size(); ++b) {
-			bool dodging = !state->players[clientId].dodgeCollide && dashTicks[clientId] > 0;
-
-			// skip X and Y collision if dodging
-			if (dodging && i != 2) continue;
-
-			if (checkCollision(playerBox, boxes2d[b])) {
-				if (i == 2 && playerBox.minZ <= boxes2d[b].maxZ && delta[2] < 0) {
-					// Landing on top of a box
-					delta[2] = boxes2d[b].maxZ + playerRadius - state->players[clientId].z;
-					state->players[clientId].isGrounded = true;
-					state->players[clientId].availableJumps = state->players[clientId].jumpCounts;
-					state->players[clientId].zVelocity = 0;
-				}
-				else {
-					float distance = findDistance(staticPlayerBox, boxes2d[b], i) * (delta[i] > 0 ? 1 : -1);
-					if (abs(distance) < abs(delta[i])) delta[i] = distance;
-				}
-			}
-
-			
-			//if (checkCollision(playerBox, boxes2d[b]))
-			//{
-			//	// If the z is being changed DOWNWARDS and collides, reset z velocity and "ground" player
-			//	if (i == 2 && playerBox.minZ < boxes2d[b].maxZ && delta[2] < 0) {
-			//		// printf("[CLIENT %d] Collision DOWNWARD with box detected. zVelocity=%f, deltaZ=%f\n", clientId,  state->players[clientId].zVelocity, delta[2]);
-
-			//		// newZ - playerRadius	= surfaceZ
-			//		// newZ					= surfaceZ + playerRadius
-			//		// currentZ + deltaZ	= surfaceZ + playerRadius
-			//		// deltaZ				= surfaceZ + playerRadius - currentZ
-			//		delta[2] = boxes2d[b].maxZ + playerRadius - state->players[clientId].z;
-			//		state->players[clientId].isGrounded = true;
-			//		state->players[clientId].availableJumps = state->players[clientId].jumpCounts; // reset jumps on ground contact
-			//		state->players[clientId].zVelocity = 0;
-			//		/*
-			//		printf("BOXID=%llu, box.minZ=%f, box.maxZ=%f\n", b, boxes2d[b].minZ, boxes2d[b].maxZ);
-			//		printf("Dynamic playerbox: PLAYERBOX.minZ=%f, PLAYERBOX.maxZ=%f\n", playerBox.minZ, playerBox.maxZ);
-			//		printf("Static  playerbox: PLAYERBOX.minZ=%f, PLAYERBOX.maxZ=%f\n", staticPlayerBox.minZ, staticPlayerBox.maxZ);
-			//		*/
-			//	}
-			//	else {
-			//		float distance = findDistance(staticPlayerBox, boxes2d[b], i) * (delta[i] > 0 ? 1 : -1);
-			//		if (abs(distance) < abs(delta[i])) delta[i] = distance;
-			//	}
-			//}
-		}
-
-	}
-
-	// hunter cannot move if stunned by bear
-	if (!state->players[clientId].isHunter || hunterBearStunTicks <= state->tick)
-	{
-		state->players[clientId].x += delta[0];
-		state->players[clientId].y += delta[1];
-		state->players[clientId].z += delta[2];
-	}
-
-	if (state->players[clientId].z < 0) {
-		state->players[clientId].z = 0;
-		state->players[clientId].zVelocity = 0;
-		if (delta[2] < 0) state->players[clientId].isGrounded = true;
-		// printf("[CLIENT %d] Collision with z-plane detected. isGrounded=%d, zVelocity=%f\n", clientId, state->players[clientId].isGrounded ? 1 : 0, state->players[clientId].zVelocity);
-	}
-
-	//printf("[CLIENT %d] MOVE: %f, %f, %f\n", clientId, state->players[clientId].x, state->players[clientId].y, state->players[clientId].z);
+void ServerGame::setMaxRewind(uint32_t ticks) {
+	// the history has to still hold the tick rewound to
+	maxRewindTicks = min(ticks, PositionHistory::CAPACITY - 1);
 }
 
-// Checks whether or not two bounding boxes are colliding
-static bool checkCollision(BoundingBox box1, BoundingBox box2) {
-	bool isColliding = (
-		(box1.minX < box2.maxX && box1.maxX > box2.minX) &&
-		(box1.minY < box2.maxY && box1.maxY > box2.minY) &&
-		(box1.minZ < box2.maxZ && box1.maxZ > box2.minZ)
-		);
-	return isColliding;
-}
-
-bool ServerGame::isHit_(const AttackPayload& a, const PlayerState& victim)
-{
-	// forward direction from yaw/pitch → unit vector
-	float fx = cosf(0) * -sinf(a.yaw);
-	float fy = cosf(0) * cosf(a.yaw);
-	float fz = sinf(0);
-
-	// vector attacker → victim
-	float vx = victim.x - a.originX;
-	float vy = victim.y - a.originY;
-	float vz = victim.z - a.originZ;
-
-	float dist2 = vx * vx + vy * vy + vz * vz;
-
-	// If the victim is within a radius (thus a sphere), always hit regardless of direction
-	float directDist = sqrtf(dist2);
-	float radius = 3e-1f;
-	if (directDist <= radius) {
-		printf("[HIT] victim is within hunter sphere. The attack counts.\n");
-		return true;
-	}
-
-	if (dist2 > attackRange * attackRange) return false;          // out of reach
-
-	float len = sqrtf(dist2);
-	if (len < 1e-4f) return false;                        // same spot?
-	float dot = (vx * fx + vy * fy + vz * fz) / len;          // cosθ
-	float cosMax = cosf(DirectX::XMConvertToRadians(ATTACK_ANGLE_DEG));
-	// Initialize the static member variable
-	return dot >= cosMax;                                 // within cone
+// The tick the other players on player `id`'s screen were at, from the view
+// tick of their last MOVE, no further back than maxRewindTicks
+uint64_t ServerGame::seenTick(unsigned int id) const {
+	uint32_t viewTick = viewTicks[id];
+	if (viewTick == 0) return state->tick;   // client did not say
+	// view ticks are the low 32 bits; one ahead of us is an estimate overshooting
+	int32_t behind = (int32_t)((uint32_t)state->tick - viewTick);
+	if (behind <= 0) return state->tick;
+	return state->tick - min((uint32_t)behind, maxRewindTicks);
 }
 
 // -----------------------------------------------------------------------------
 // BOUNDING BOXES
 // -----------------------------------------------------------------------------
 
-// Finds the distance between two bounding boxes on one axis
-static float findDistance(BoundingBox box1, BoundingBox box2, char direction) {
-	if (direction == 0) // X axis
-		return min(abs(box1.minX - box2.maxX), abs(box1.maxX - box2.minX));
-	if (direction == 1) // Y axis
-		return min(abs(box1.minY - box2.maxY), abs(box1.maxY - box2.minY));
-	if (direction == 2) // Z axis
-		return min(abs(box1.minZ - box2.maxZ), abs(box1.maxZ - box2.minZ));
+void ServerGame::readBoundingBoxes() {
+	loadCollision(L"bb#_bboxes.bin", L"bb#_bboxes.json");
 }
 
-void ServerGame::readBoundingBoxes() {
-	static std::random_device rd;                                    // seed source
-	static std::mt19937       gen(rd());                             // mersenne twister engine
-	static std::uniform_int_distribution<int> distRGBA(150, 255);    // for R,G,B
-	const wchar_t* fileAddr = L"bb#_bboxes.json";
-	
-	
-	Slice<BYTE> fileData;
-	DX::ReadDataStatus readStatus = DX::ReadDataToSlice(fileAddr, fileData, true);
-	if (readStatus != DX::ReadDataStatus::SUCCESS) {
-		fwprintf(stderr, L"Cannot read file %s\n", fileAddr);
-	};
+bool ServerGame::loadCollision(const wchar_t* bakedAddr, const wchar_t* jsonAddr) {
+	return movement.loadCollision(bakedAddr, jsonAddr);
+}
 
-	JSON_Value* rootVal = json_parse_string(reinterpret_cast<char*>(fileData.ptr));
-	free(fileData.ptr);
-
-	if (!rootVal) { fwprintf(stderr, L"Cannot parse %s\n", fileAddr); }
-	else {wprintf(L"Parsed %s\n", fileAddr);}
-	JSON_Object* rootObj = json_value_get_object(rootVal);
-	size_t       boxCnt = json_object_get_count(rootObj);
-
-
-	for (size_t i = 0; i < boxCnt; i++) {
-		const char* name = json_object_get_name(rootObj, i);
-		JSON_Object* o = json_object_get_object(rootObj, name);
-		JSON_Array* mn = json_object_get_array(o, "min");
-		JSON_Array* mx = json_object_get_array(o, "max");
-
-		// read raw Blender coords
-		float bx0 = (float)json_array_get_number(mn, 0);
-		float by0 = (float)json_array_get_number(mn, 1);
-		float bz0 = (float)json_array_get_number(mn, 2);
-
-		float bx1 = (float)json_array_get_number(mx, 0);
-		float by1 = (float)json_array_get_number(mx, 1);
-		float bz1 = (float)json_array_get_number(mx, 2);
-
-		// each box → 6 floats: {min.x, min.y, min.z, max.x, max.y, max.z}
-		BoundingBox box2d = { bx0, by0, bz0, bx1, by1, bz1 };
-		boxes2d.push_back(box2d);
-		//cout << "box2d: " << box2d[0] << ", " << box2d[1] << ", " << box2d[2] << ", " << box2d[3] << ", " << box2d[4] << ", " << box2d[5] << endl;
-
-		// colors2d[i][0..3] = R, G, B, A (0–255)
-		vector<int> color2d;
-		// pick a random Color in colors2d
-		color2d.push_back(static_cast<unsigned char>(distRGBA(gen)));  // R
-		color2d.push_back(static_cast<unsigned char>(distRGBA(gen)));  // G
-		color2d.push_back(static_cast<unsigned char>(distRGBA(gen)));  // B
-		color2d.push_back(200);                       // A
-		colors2d.push_back(color2d);
-	}
-	json_value_free(rootVal);
+int ServerGame::bakeCollision(const wchar_t* jsonAddr, const wchar_t* bakedAddr) {
+	return PlayerMovement::bakeCollision(jsonAddr, bakedAddr);
 }
 
 ServerGame::~ServerGame() {
+#if TICK_PROFILE
+	profiler.dump(PROFILE_FILE, TICK_BUDGET_NS);
+	printf("[PROFILE] wrote %s\n", PROFILE_FILE);
+#endif
+	if (recorder) {
+		printf("[RECORD] %llu packets, %llu bytes\n", (unsigned long long)recorder->packets(), (unsigned long long)recorder->bytes());
+	}
+	delete recorder;
 	delete network;
 	delete state;
 }
\ No newline at end of file
@@ -1,10 +1,92 @@
 #include "ServerGame.h"
+#include "Benchmarks.h"
+#include "HeadlessSim.h"
 #include "Parson.h"
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <filesystem>
 using namespace std;
-int main() {
+
+// set by Ctrl+C so the loop can end and the server shut down cleanly
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) {
+    stopRequested = 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench-collision") == 0) {
+        return benchCollision();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-snapshot") == 0) {
+        return benchSnapshot();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-swing") == 0) {
+        return benchSwing();
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-udp") == 0) {
+        // --bench-udp [loss percent]
+        return benchUdp(argc > 2 ? (float)atof(argv[2]) : 20.0f);
+    }
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0) {
+        // --headless [ticks] [seed] [--record log]
+        uint64_t ticks = argc > 2 ? strtoull(argv[2], nullptr, 10) : 64 * 60 * 60;
+        uint32_t seed = argc > 3 ? (uint32_t)strtoul(argv[3], nullptr, 10) : 125;
+        bool record = argc > 5 && strcmp(argv[4], "--record") == 0;
+        std::filesystem::path recordAddr = record ? argv[5] : "";
+        return runHeadless(ticks, seed, record ? recordAddr.wstring().c_str() : nullptr);
+    }
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+        // --replay log [states]
+        std::filesystem::path logAddr = argv[2];
+        std::filesystem::path statesAddr = argc > 3 ? argv[3] : "";
+        return runReplay(logAddr.wstring().c_str(), argc > 3 ? statesAddr.wstring().c_str() : nullptr);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bake") == 0) {
+        // --bake [in.json] [out.bin]
+        std::filesystem::path jsonAddr = argc > 2 ? argv[2] : "bb#_bboxes.json";
+        std::filesystem::path bakedAddr = argc > 3 ? argv[3] : "bb#_bboxes.bin";
+        return ServerGame::bakeCollision(jsonAddr.wstring().c_str(), bakedAddr.wstring().c_str());
+    }
+
     ServerGame server;
+    for (int i = 1; i < argc; i++) {
+        // --record log
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            server.startRecording(std::filesystem::path(argv[i + 1]).wstring().c_str());
+        }
+        // --raw-state: full GameState structs instead of snapshots
+        if (strcmp(argv[i], "--raw-state") == 0) {
+            server.setRawState(true);
+        }
+        // --udp-loss percent [latency ms] [jitter ms]
+        if (strcmp(argv[i], "--udp-loss") == 0 && i + 1 < argc) {
+            LossSimulator loss;
+            loss.lossPercent = (float)atof(argv[i + 1]);
+            if (i + 2 < argc && argv[i + 2][0] != '-') loss.latencyMs = (uint32_t)atoi(argv[i + 2]);
+            if (i + 3 < argc && argv[i + 2][0] != '-' && argv[i + 3][0] != '-') loss.jitterMs = (uint32_t)atoi(argv[i + 3]);
+            server.simulateLoss(loss);
+        }
+        // --max-rewind ms: lag compensation of the hunter's swings, 0 turns it off
+        if (strcmp(argv[i], "--max-rewind") == 0 && i + 1 < argc) {
+            uint32_t ms = (uint32_t)atoi(argv[i + 1]);
+            server.setMaxRewind((ms * PlayerMovement::TICKS_PER_SEC + 500) / 1000);
+        }
+        // --catch-up skip | --catch-up burst [max ticks]
+        if (strcmp(argv[i], "--catch-up") != 0 || i + 1 >= argc) continue;
+        if (strcmp(argv[i + 1], "skip") == 0) {
+            server.setCatchUp(TickScheduler::CatchUp::SKIP, 1);
+        }
+        else if (strcmp(argv[i + 1], "burst") == 0) {
+            int maxTicks = i + 2 < argc ? atoi(argv[i + 2]) : 0;
+            server.setCatchUp(TickScheduler::CatchUp::BURST, maxTicks > 0 ? maxTicks : 4);
+        }
+    }
     server.readBoundingBoxes();
-    while (true) {
+    signal(SIGINT, requestStop);
+    while (!stopRequested) {
         server.update();
     }
-}
\ No newline at end of file
+    return 0;
+}
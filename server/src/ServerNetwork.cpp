@@ -1,21 +1,28 @@
 #include "ServerNetwork.h"
+#include <algorithm>
+#include <cstdlib>
 
-ServerNetwork::ServerNetwork(void) {
-	WSADATA wsaData;
+#if !defined(_WIN32)
+// nothing to start up or clean up for POSIX sockets
+static void WSACleanup() {}
+#endif
 
+ServerNetwork::ServerNetwork(void) {
 	ListenSocket = INVALID_SOCKET;
-	ClientSocket = INVALID_SOCKET;
 
 	struct addrinfo *result = NULL,
 					hints;
 
+#if defined(_WIN32)
+	WSADATA wsaData;
 	iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
 	if (iResult != 0) {
 		printf("WSAStartup failed with error: %d\n", iResult);
 		exit(1);
 	}
+#endif
 
-	ZeroMemory(&hints, sizeof(hints));
+	memset(&hints, 0, sizeof(hints));
 	hints.ai_family = AF_INET;
 	hints.ai_socktype = SOCK_STREAM;
 	hints.ai_protocol = IPPROTO_TCP;
@@ -72,78 +79,336 @@ ServerNetwork::ServerNetwork(void) {
 		WSACleanup();
 		exit(1);
 	}
+
+	events.add(ListenSocket);
+
+	// clients that asked for UDP reach the same port, TCP still works without it
+	if (udpSocket.open((uint16_t)atoi(DEFAULT_PORT))) {
+		printf("[UDP] listening on port %s\n", DEFAULT_PORT);
+		events.add(udpSocket.handle());
+	}
 }
 
-bool ServerNetwork::acceptNewClient(unsigned int& id) {
-	ClientSocket = accept(ListenSocket, NULL, NULL);
+static uint64_t addressKey(const sockaddr_in& addr) {
+	return ((uint64_t)addr.sin_addr.s_addr << 16) | addr.sin_port;
+}
 
-	if (ClientSocket == INVALID_SOCKET){
-		int err = WSAGetLastError();
-		if (err == WSAEWOULDBLOCK) {
-			// no pending connection this tick
-			return false;
+void ServerNetwork::poll(int timeoutMs) {
+	events.wait(timeoutMs, ready);
+	for (const EventLoop::Event& event : ready) {
+		if (event.sock == ListenSocket) {
+			acceptPending();
+			continue;
+		}
+		if (event.sock == udpSocket.handle()) {
+			pollUdp();
+			continue;
 		}
 
-		printf("accept failed with error: %d\n", err);
-		return false;                   // or handle as fatal
+		auto known = tcpIds.find(event.sock);
+		if (known == tcpIds.end()) continue;
+		TcpPeer& peer = tcpPeers.at(known->second);
+		if (event.writable) writeUnsent(known->second, peer);
+		if (event.readable) readTcp(known->second, peer);
 	}
 
-	u_long iMode = 0;
-	// set client socket back to blocking
-	if (ioctlsocket(ClientSocket, FIONBIO, &iMode) == SOCKET_ERROR) {
-		printf("ioctlsocket failed on client socket: %d\n", WSAGetLastError());
-		closesocket(ClientSocket);
-		return false;
+	for (unsigned int id : closing) {
+		disconnect(id);
 	}
+	closing.clear();
+}
+
+void ServerNetwork::acceptPending() {
+	while (true) {
+		SOCKET clientSocket = accept(ListenSocket, NULL, NULL);
+		if (clientSocket == INVALID_SOCKET) {
+			int err = WSAGetLastError();
+			if (err != WSAEWOULDBLOCK) {
+				printf("accept failed with error: %d\n", err);
+			}
+			return;
+		}
+
+		// Windows hands out accepted sockets non-blocking like the listen
+		// socket, POSIX does not
+		u_long iMode = 1;
+		if (ioctlsocket(clientSocket, FIONBIO, &iMode) == SOCKET_ERROR) {
+			printf("ioctlsocket failed on client socket: %d\n", WSAGetLastError());
+			closesocket(clientSocket);
+			continue;
+		}
+
+		// disable nagle
+		int value = 1;
+		setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, (const char*)&value, sizeof(value));
+		accepted.push_back(clientSocket);
+	}
+}
 
-	// disable nagle
-	char value = 1;
-	setsockopt(ClientSocket, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+bool ServerNetwork::acceptNewClient(unsigned int& id) {
+	if (!accepted.empty()) {
+		SOCKET clientSocket = accepted.front();
+		accepted.erase(accepted.begin());
+		tcpPeers[id].sock = clientSocket;
+		tcpIds[clientSocket] = id;
+		events.add(clientSocket);
+		sessions.insert(pair<unsigned int, SOCKET>(id, clientSocket));
+		return true;
+	}
 
-	sessions.insert(pair<unsigned int, SOCKET>(id, ClientSocket));
+	// no TCP connection waiting, take a UDP one if there is
+	if (udpNewcomers.empty()) return false;
+	UdpPeer& peer = udpNewcomers.front();
+	udpIds[addressKey(peer.addr)] = id;
+	udpPeers.emplace(id, std::move(peer));
+	udpNewcomers.erase(udpNewcomers.begin());
+	sessions.insert(pair<unsigned int, SOCKET>(id, INVALID_SOCKET));
 	return true;
 }
 
-int ServerNetwork::receiveData(unsigned int client_id, char* recvbuf) {
-	if (sessions.find(client_id) != sessions.end()) {
-		SOCKET curSocket = sessions[client_id];
-		iResult = NetworkServices::recvMessage(curSocket, recvbuf, MAX_PACKET_SIZE);
-		if (iResult == 0) {
+void ServerNetwork::readTcp(unsigned int client_id, TcpPeer& peer) {
+	for (int reads = 0; reads < MAX_READS; reads++) {
+		size_t space;
+		char* span = peer.inbox.writeSpan(space);
+		// full: the game has not caught up, TCP holds the client back meanwhile
+		if (space == 0) return;
+
+		int r = NetworkServices::recvMessage(peer.sock, span, (int)space);
+		if (r > 0) {
+			peer.inbox.commit(r);
+			// less than asked for means drained, no need for a recv to say so
+			if ((size_t)r < space) return;
+			continue;
+		}
+		if (r == 0) {
 			printf("Connection closed\n");
-			closesocket(curSocket);
+			closing.push_back(client_id);
+		}
+		else if (WSAGetLastError() != WSAEWOULDBLOCK) {
+			printf("recv from client %u failed with error: %d\n", client_id, WSAGetLastError());
+			closing.push_back(client_id);
 		}
-		return iResult;
+		return;
 	}
-	return 0;
+}
+
+bool ServerNetwork::nextPacket(unsigned int client_id, PacketRing::View& packet) {
+	auto udp = udpPeers.find(client_id);
+	if (udp != udpPeers.end()) {
+		UdpPeer& peer = udp->second;
+		if (peer.inboxRead == peer.inbox.size()) {
+			peer.inbox.clear();
+			peer.inboxRead = 0;
+			return false;
+		}
+		PacketHeader hdr;
+		memcpy(&hdr, &peer.inbox[peer.inboxRead], sizeof hdr);
+		packet = { &peer.inbox[peer.inboxRead], hdr.len };
+		peer.inboxRead += hdr.len;
+		return true;
+	}
+
+	auto tcp = tcpPeers.find(client_id);
+	if (tcp == tcpPeers.end()) return false;
+	if (tcp->second.inbox.next(packet)) return true;
+	if (tcp->second.inbox.corrupt() && std::find(closing.begin(), closing.end(), client_id) == closing.end()) {
+		printf("client %u sent a packet with a bad length, closing\n", client_id);
+		closing.push_back(client_id);
+	}
+	return false;
+}
+
+void ServerNetwork::Outbound::add(bool shared, uint32_t offset, uint32_t length) {
+	// packets queued back to back from the same buffer make one piece
+	if (!pieces.empty()) {
+		Piece& last = pieces.back();
+		if (last.shared == shared && last.offset + last.length == offset) {
+			last.length += length;
+			return;
+		}
+	}
+	pieces.push_back({ shared, offset, length });
 }
 
 void ServerNetwork::sendToAll(char* packets, int totalSize) {
-	SOCKET curSocket;
-	std::map<unsigned int, SOCKET>::iterator iter;
-	int iResult;
+	uint32_t offset = (uint32_t)broadcast.size();
+	broadcast.insert(broadcast.end(), packets, packets + totalSize);
 
-	for (iter = sessions.begin(); iter != sessions.end(); iter++) {
-		curSocket = iter->second;
-		iResult = NetworkServices::sendMessage(curSocket, packets, totalSize);
-		if (iResult == SOCKET_ERROR) {
-			printf("sendToAll failed with error: %d\n", WSAGetLastError());
-			closesocket(curSocket);
+	for (auto& [id, curSocket] : sessions) {
+		auto tcp = tcpPeers.find(id);
+		if (tcp == tcpPeers.end()) {
+			sendToClient(id, packets, totalSize);
+			continue;
 		}
+		tcp->second.queued.add(true, offset, (uint32_t)totalSize);
+		stats.queued++;
 	}
 }
 
 void ServerNetwork::sendToClient(unsigned int client_id, char* packets, int totalSize) {
-	int iResult;
-	if (sessions.find(client_id) != sessions.end()) {
-		SOCKET curSocket = sessions[client_id];
-		iResult = NetworkServices::sendMessage(curSocket, packets, totalSize);
-		if (iResult == SOCKET_ERROR) {
-			printf("sendToClient failed with error: %d\n", WSAGetLastError());
-			closesocket(curSocket);
+	auto udp = udpPeers.find(client_id);
+	if (udp != udpPeers.end()) {
+		udp->second.connection.send(packets, totalSize, udpNowMs());
+		stats.queued++;
+		return;
+	}
+
+	auto tcp = tcpPeers.find(client_id);
+	if (tcp != tcpPeers.end()) {
+		Outbound& out = tcp->second.queued;
+		out.add(false, (uint32_t)out.own.size(), (uint32_t)totalSize);
+		out.own.insert(out.own.end(), packets, packets + totalSize);
+		stats.queued++;
+	}
+}
+
+void ServerNetwork::flushTcp(unsigned int client_id, TcpPeer& peer) {
+	Outbound& out = peer.queued;
+	size_t next = 0;
+	// a write still waiting on the socket goes first, everything joins it
+	while (peer.unsent.empty() && next < out.pieces.size()) {
+		const char* parts[NetworkServices::GATHER_MAX];
+		int lengths[NetworkServices::GATHER_MAX];
+		int count = 0, total = 0;
+		for (; count < NetworkServices::GATHER_MAX && next + count < out.pieces.size(); count++) {
+			const Outbound::Piece& piece = out.pieces[next + count];
+			parts[count] = (piece.shared ? broadcast.data() : out.own.data()) + piece.offset;
+			lengths[count] = (int)piece.length;
+			total += lengths[count];
+		}
+		int sent = NetworkServices::sendGather(peer.sock, parts, lengths, count);
+		stats.sendCalls++;
+		if (sent == SOCKET_ERROR) {
+			if (WSAGetLastError() != WSAEWOULDBLOCK) {
+				printf("send to client %u failed with error: %d\n", client_id, WSAGetLastError());
+				closing.push_back(client_id);
+				break;
+			}
+			sent = 0;
+		}
+		stats.bytes += sent;
+		next += count;
+
+		// the kernel took part of it, keep the rest of these pieces
+		for (int i = 0; i < count && sent < total; i++) {
+			int skip = min(sent, lengths[i]);
+			peer.unsent.insert(peer.unsent.end(), parts[i] + skip, parts[i] + lengths[i]);
+			sent -= skip;
+		}
+	}
+	for (; next < out.pieces.size(); next++) {
+		const Outbound::Piece& piece = out.pieces[next];
+		const char* part = (piece.shared ? broadcast.data() : out.own.data()) + piece.offset;
+		peer.unsent.insert(peer.unsent.end(), part, part + piece.length);
+	}
+	if (!peer.unsent.empty()) {
+		events.watchWrite(peer.sock, true);
+	}
+	out.pieces.clear();
+	out.own.clear();
+}
+
+void ServerNetwork::writeUnsent(unsigned int client_id, TcpPeer& peer) {
+	if (peer.unsent.empty()) return;
+	int sent = NetworkServices::sendMessage(peer.sock, peer.unsent.data(), (int)peer.unsent.size());
+	stats.sendCalls++;
+	if (sent == SOCKET_ERROR) {
+		if (WSAGetLastError() != WSAEWOULDBLOCK) {
+			printf("send to client %u failed with error: %d\n", client_id, WSAGetLastError());
+			closing.push_back(client_id);
+		}
+		return;
+	}
+	stats.bytes += sent;
+	peer.unsent.erase(peer.unsent.begin(), peer.unsent.begin() + sent);
+	if (peer.unsent.empty()) {
+		events.watchWrite(peer.sock, false);
+	}
+}
+
+void ServerNetwork::disconnect(unsigned int client_id) {
+	auto tcp = tcpPeers.find(client_id);
+	if (tcp == tcpPeers.end()) return;
+	events.remove(tcp->second.sock);
+	closesocket(tcp->second.sock);
+	tcpIds.erase(tcp->second.sock);
+	tcpPeers.erase(tcp);
+	sessions.erase(client_id);
+	disconnected.push_back(client_id);
+}
+
+void ServerNetwork::sendDatagrams(UdpPeer& peer) {
+	for (const auto& datagram : peer.connection.outgoing) {
+		udpSocket.sendTo(peer.addr, datagram.data(), datagram.size());
+	}
+	peer.connection.outgoing.clear();
+}
+
+void ServerNetwork::pollUdp() {
+	uint64_t now = udpNowMs();
+	sockaddr_in from;
+	std::vector<uint8_t> datagram;
+	while (udpSocket.receive(from, datagram)) {
+		auto known = udpIds.find(addressKey(from));
+		if (known != udpIds.end()) {
+			UdpPeer& peer = udpPeers.at(known->second);
+			peer.connection.receive(datagram.data(), datagram.size(), now, peer.inbox);
+			continue;
+		}
+
+		auto newcomer = std::find_if(udpNewcomers.begin(), udpNewcomers.end(),
+			[&](const UdpPeer& p) { return addressKey(p.addr) == addressKey(from); });
+		if (newcomer != udpNewcomers.end()) {
+			newcomer->connection.receive(datagram.data(), datagram.size(), now, newcomer->inbox);
+			continue;
+		}
+
+		UdpPeer peer{ from, UdpConnection(now), {} };
+		if (peer.connection.receive(datagram.data(), datagram.size(), now, peer.inbox)) {
+			udpNewcomers.push_back(std::move(peer));
 		}
 	}
 }
 
+void ServerNetwork::flush() {
+	for (auto& [id, peer] : tcpPeers) {
+		if (!peer.queued.pieces.empty()) flushTcp(id, peer);
+	}
+	broadcast.clear();
+	for (unsigned int id : closing) {
+		disconnect(id);
+	}
+	closing.clear();
+
+	uint64_t now = udpNowMs();
+	for (auto iter = udpPeers.begin(); iter != udpPeers.end();) {
+		UdpPeer& peer = iter->second;
+		if (peer.connection.timedOut(now)) {
+			printf("[UDP] client %u timed out\n", iter->first);
+			udpIds.erase(addressKey(peer.addr));
+			sessions.erase(iter->first);
+			disconnected.push_back(iter->first);
+			iter = udpPeers.erase(iter);
+			continue;
+		}
+		peer.connection.update(now);
+		for (const auto& datagram : peer.connection.outgoing) {
+			stats.bytes += datagram.size();
+		}
+		sendDatagrams(peer);
+		++iter;
+	}
+	udpSocket.flush(now);
+	stats.sendCalls += udpSocket.sendCalls() - udpCallsBefore;
+	udpCallsBefore = udpSocket.sendCalls();
+	stats.ticks++;
+}
+
+void ServerNetwork::simulateLoss(const LossSimulator& loss) {
+	udpSocket.simulate(loss, 125);
+	printf("[UDP] simulating %.0f%% loss, %u ms latency, %u ms jitter\n", loss.lossPercent, loss.latencyMs, loss.jitterMs);
+}
+
 ServerNetwork::~ServerNetwork() {
 	for (auto& [id, sock] : sessions) {
 		if (sock != INVALID_SOCKET) {
@@ -152,6 +417,9 @@ ServerNetwork::~ServerNetwork() {
 		}
 	}
 	sessions.clear();
+	for (SOCKET sock : accepted) {
+		closesocket(sock);
+	}
 
 	if (ListenSocket != INVALID_SOCKET) {
 		shutdown(ListenSocket, SD_BOTH);
@@ -159,11 +427,5 @@ ServerNetwork::~ServerNetwork() {
 		ListenSocket = INVALID_SOCKET;
 	}
 
-	if (ClientSocket != INVALID_SOCKET){
-		shutdown(ClientSocket, SD_BOTH);
-		closesocket(ClientSocket);
-		ClientSocket = INVALID_SOCKET;
-	}
-
 	WSACleanup();
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "TickProfiler.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+// ----------------------------------------------------------------------------
+// LATENCY HISTOGRAM
+// ----------------------------------------------------------------------------
+
+int LatencyHistogram::bucketOf(uint64_t ns) {
+	if (ns < (uint64_t)LINEAR) return (int)ns;
+	int exp = std::bit_width(ns) - 1;
+	if (exp >= MAX_EXP) return BUCKETS - 1;
+	int sub = (int)(ns >> (exp - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+	return LINEAR + ((exp - SUB_BITS - 1) << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucketTop(int bucket) {
+	if (bucket < LINEAR) return (uint64_t)bucket;
+	int row = (bucket - LINEAR) >> SUB_BITS;
+	int sub = (bucket - LINEAR) & ((1 << SUB_BITS) - 1);
+	int shift = row + 1;
+	uint64_t low = (uint64_t)((1 << SUB_BITS) + sub) << shift;
+	return low + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+	counts[bucketOf(ns)]++;
+	total++;
+	sum += ns;
+	lowest = std::min(lowest, ns);
+	highest = std::max(highest, ns);
+}
+
+void LatencyHistogram::clear() {
+	counts.fill(0);
+	total = 0;
+	sum = 0;
+	lowest = UINT64_MAX;
+	highest = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+	if (total == 0) return 0;
+	uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p * total));
+	uint64_t seen = 0;
+	for (int b = 0; b < BUCKETS; b++) {
+		seen += counts[b];
+		if (seen >= rank) return std::min(bucketTop(b), highest);
+	}
+	return highest;
+}
+
+// ----------------------------------------------------------------------------
+// TICK PROFILER
+// ----------------------------------------------------------------------------
+
+const char* TickProfiler::name(Phase phase) {
+	switch (phase) {
+	case Phase::TICK:       return "tick";
+	case Phase::TIMERS:     return "timers";
+	case Phase::RECEIVE:    return "receiveFromClients";
+	case Phase::MOVEMENTS:  return "applyMovements";
+	case Phase::CAMERA:     return "applyCamera";
+	case Phase::PHYSICS:    return "applyPhysics";
+	case Phase::ATTACKS:    return "applyAttacks";
+	case Phase::INSTINCT:   return "applyInstinct";
+	case Phase::SEND_STATE: return "sendGameStateUpdates";
+	case Phase::GAME_PHASE: return "handleGamePhase";
+	case Phase::MENU:       return "menus";
+	case Phase::ANIMATIONS: return "sendAnimationUpdates";
+	case Phase::FLUSH:      return "flush";
+	default:                return "?";
+	}
+}
+
+void TickProfiler::clear() {
+	for (auto& h : phases) {
+		h.clear();
+	}
+	since = std::chrono::steady_clock::now();
+}
+
+bool TickProfiler::dump(const char* fileAddr, uint64_t budgetNs) const {
+	std::ofstream outFile(fileAddr, std::ios::out | std::ios::trunc);
+	if (!outFile) {
+		printf("[PROFILE] could not write %s\n", fileAddr);
+		return false;
+	}
+
+	char line[256];
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+	snprintf(line, sizeof(line), "tick phases over %.1f s, times in us, budget %.3f ms per tick\n\n", seconds, budgetNs / 1e6);
+	outFile << line;
+	snprintf(line, sizeof(line), "%-22s %10s %9s %9s %9s %9s %9s %9s %8s\n",
+		"phase", "samples", "mean", "p50", "p90", "p99", "p99.9", "max", "p99/bud");
+	outFile << line;
+	for (int i = 0; i < (int)Phase::COUNT; i++) {
+		const LatencyHistogram& h = phases[i];
+		if (h.count() == 0) continue;
+		snprintf(line, sizeof(line), "%-22s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %7.1f%%\n",
+			name((Phase)i), (unsigned long long)h.count(), h.mean() / 1e3,
+			h.percentile(0.5) / 1e3, h.percentile(0.9) / 1e3, h.percentile(0.99) / 1e3,
+			h.percentile(0.999) / 1e3, h.maxValue() / 1e3, 100.0 * h.percentile(0.99) / budgetNs);
+		outFile << line;
+	}
+	return (bool)outFile;
+}
@@ -0,0 +1,108 @@
+#include "TickScheduler.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment (lib, "Winmm.lib")
+#endif
+
+using namespace std::chrono;
+
+TickScheduler::TickScheduler(uint32_t ticksPerSec, CatchUp mode, uint32_t maxCatchUp)
+	: ticksPerSec(ticksPerSec), mode(mode), maxCatchUp(std::max(maxCatchUp, 1u)) {
+#if defined(_WIN32)
+	// the default 15.6 ms scheduler quantum is a whole tick
+	timeBeginPeriod(1);
+#endif
+}
+
+TickScheduler::~TickScheduler() {
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
+}
+
+void TickScheduler::configure(CatchUp newMode, uint32_t newMaxCatchUp) {
+	mode = newMode;
+	maxCatchUp = std::max(newMaxCatchUp, 1u);
+}
+
+TickScheduler::clock::time_point TickScheduler::deadline(uint64_t index) const {
+	return start + nanoseconds(index * 1'000'000'000ull / ticksPerSec);
+}
+
+void TickScheduler::sleepUntil(clock::time_point due) {
+	auto now = clock::now();
+	if (due - now > SPIN_MARGIN) {
+		std::this_thread::sleep_for(due - now - SPIN_MARGIN);
+		auto woke = clock::now();
+		counters.sleptNs += duration_cast<nanoseconds>(woke - now).count();
+		now = woke;
+	}
+	auto spinStart = now;
+	while (now < due) {
+		std::this_thread::yield();
+		now = clock::now();
+	}
+	counters.spunNs += duration_cast<nanoseconds>(now - spinStart).count();
+}
+
+uint32_t TickScheduler::wait() {
+	if (!started) {
+		started = true;
+		start = clock::now();
+		next = 1;
+		counters.ticks++;
+		return 1;
+	}
+
+	auto due = deadline(next);
+	if (clock::now() < due) {
+		sleepUntil(due);
+		int64_t late = duration_cast<nanoseconds>(clock::now() - due).count();
+		counters.lateSumNs += late;
+		counters.lateMaxNs = std::max(counters.lateMaxNs, late);
+		next++;
+		counters.ticks++;
+		return 1;
+	}
+
+	// behind schedule: every deadline up to `reached` has passed
+	auto now = clock::now();
+	int64_t late = duration_cast<nanoseconds>(now - due).count();
+	counters.overruns++;
+	counters.lateMaxNs = std::max(counters.lateMaxNs, late);
+
+	uint64_t elapsedNs = (uint64_t)duration_cast<nanoseconds>(now - start).count();
+	uint64_t reached = std::max<uint64_t>(elapsedNs * ticksPerSec / 1'000'000'000ull, next);
+	uint64_t missed = reached - next + 1;
+	uint32_t steps = mode == CatchUp::BURST ? (uint32_t)std::min<uint64_t>(missed, maxCatchUp) : 1;
+
+	if (missed > steps) {
+		// give up on the rest, the next deadline stays on the original grid
+		printf("[TICK] %.1f ms behind, running %u tick(s) and dropping %llu\n",
+			late / 1e6, steps, (unsigned long long)(missed - steps));
+		counters.skipped += missed - steps;
+		next = reached + 1;
+	}
+	else {
+		next += steps;
+	}
+	counters.caughtUp += steps - 1;
+	counters.ticks += steps;
+	return steps;
+}
+
+void TickScheduler::printStats() const {
+	uint64_t onTime = counters.ticks - counters.overruns - counters.caughtUp;
+	printf("[TICK] %llu ticks, %llu overruns, %llu caught up, %llu skipped, "
+		"jitter avg %.3f ms max %.3f ms, slept %.2f s, spun %.2f s\n",
+		(unsigned long long)counters.ticks, (unsigned long long)counters.overruns,
+		(unsigned long long)counters.caughtUp, (unsigned long long)counters.skipped,
+		onTime ? counters.lateSumNs / 1e6 / onTime : 0.0, counters.lateMaxNs / 1e6,
+		counters.sleptNs / 1e9, counters.spunNs / 1e9);
+}
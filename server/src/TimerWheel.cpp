@@ -0,0 +1,144 @@
+#include "TimerWheel.h"
+#include <algorithm>
+#include <utility>
+
+TimerWheel::TimerWheel(uint64_t now) : now(now) {
+	for (auto& level : slots) {
+		level.fill(NONE);
+	}
+}
+
+bool TimerWheel::valid(Handle handle) const {
+	return handle.index < nodes.size() &&
+		nodes[handle.index].live &&
+		nodes[handle.index].generation == handle.generation;
+}
+
+TimerWheel::Handle TimerWheel::schedule(uint64_t tick, Callback onExpire) {
+	uint32_t i;
+	if (!freeList.empty()) {
+		i = freeList.back();
+		freeList.pop_back();
+	}
+	else {
+		i = (uint32_t)nodes.size();
+		nodes.emplace_back();
+	}
+
+	Node& node = nodes[i];
+	node.deadline = std::max(tick, now + 1);
+	node.seq = nextSeq++;
+	node.onExpire = std::move(onExpire);
+	node.live = true;
+	active++;
+	link(i);
+	return { i, node.generation };
+}
+
+bool TimerWheel::cancel(Handle& handle) {
+	if (!valid(handle)) return false;
+	unlink(handle.index);
+	release(handle.index);
+	handle = {};
+	return true;
+}
+
+bool TimerWheel::pending(Handle handle) const {
+	return valid(handle);
+}
+
+uint64_t TimerWheel::deadline(Handle handle) const {
+	return valid(handle) ? nodes[handle.index].deadline : 0;
+}
+
+void TimerWheel::link(uint32_t i) {
+	Node& node = nodes[i];
+	// park timers beyond the wheel on the top level, cascade re-files them
+	uint64_t due = std::min(node.deadline, now + SPAN - 1);
+	uint64_t delta = due - now;
+	int level = 0;
+	while (level < LEVELS - 1 && delta >= (1ull << (LEVEL_BITS * (level + 1)))) {
+		level++;
+	}
+	uint32_t slot = (uint32_t)(due >> (LEVEL_BITS * level)) & (SLOTS - 1);
+
+	node.level = (uint16_t)level;
+	node.slot = (uint16_t)slot;
+	node.prev = NONE;
+	node.next = slots[level][slot];
+	if (node.next != NONE) nodes[node.next].prev = i;
+	slots[level][slot] = i;
+}
+
+void TimerWheel::unlink(uint32_t i) {
+	Node& node = nodes[i];
+	if (node.prev != NONE) nodes[node.prev].next = node.next;
+	else slots[node.level][node.slot] = node.next;
+	if (node.next != NONE) nodes[node.next].prev = node.prev;
+	node.prev = node.next = NONE;
+}
+
+void TimerWheel::release(uint32_t i) {
+	Node& node = nodes[i];
+	node.live = false;
+	node.generation++;
+	node.onExpire = nullptr;
+	freeList.push_back(i);
+	active--;
+}
+
+void TimerWheel::cascade(int level) {
+	uint32_t slot = (uint32_t)(now >> (LEVEL_BITS * level)) & (SLOTS - 1);
+	uint32_t i = slots[level][slot];
+	slots[level][slot] = NONE;
+	while (i != NONE) {
+		uint32_t next = nodes[i].next;
+		link(i);
+		i = next;
+	}
+}
+
+void TimerWheel::advance(uint64_t tick) {
+	while (now < tick) {
+		now++;
+
+		// a level's slot is due once every lower level wrapped around;
+		// higher levels first so their timers can drop all the way down
+		int top = 0;
+		while (top < LEVELS - 1 && (now & ((1ull << (LEVEL_BITS * (top + 1))) - 1)) == 0) {
+			top++;
+		}
+		for (int level = top; level > 0; level--) {
+			cascade(level);
+		}
+
+		uint32_t slot = (uint32_t)now & (SLOTS - 1);
+		if (slots[0][slot] == NONE) continue;
+
+		firing.clear();
+		for (uint32_t i = slots[0][slot]; i != NONE; i = nodes[i].next) {
+			firing.push_back({ i, nodes[i].generation });
+		}
+		std::sort(firing.begin(), firing.end(), [this](const auto& a, const auto& b) {
+			return nodes[a.first].seq < nodes[b.first].seq;
+		});
+
+		for (auto [i, generation] : firing) {
+			// an earlier callback may have cancelled this one
+			if (!valid({ i, generation })) continue;
+			Callback onExpire = std::move(nodes[i].onExpire);
+			unlink(i);
+			release(i);
+			if (onExpire) onExpire();
+		}
+	}
+}
+
+void TimerWheel::clear() {
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++) {
+		if (nodes[i].live) {
+			unlink(i);
+			release(i);
+		}
+	}
+}